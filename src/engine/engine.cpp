@@ -1,5 +1,7 @@
 #include <SDL.h>
+#include <SDL_image.h>
 #include "engine.h"
+#include "jobs.h"
 #include <iostream>
 #include <random>
 #include <chrono>
@@ -21,6 +23,12 @@ void engine::init() {
 	SDL_RWops* ptr = SDL_RWFromConstMem(buffer, static_cast<int>(buffer_size));
 
 	TextBox::init(ptr);
+
+	// Loads the png decoder up front, IMG_Load loading it lazily is not thread safe.
+	if ((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
+		throw SDL_exception("Could not initialize SDL_image, " + std::string(IMG_GetError()));
+	}
+	start_jobs();
 }
 
 int random(const int min, const int max) {
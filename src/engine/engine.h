@@ -14,6 +14,9 @@ struct SurfaceDeleter {
 };
 
 namespace engine {
+	/**
+	 * Loads the default font and image decoders, and starts the job system.
+	 */
 	void init();
 
     /**
@@ -0,0 +1,95 @@
+#include "fileWatcher.h"
+#include <algorithm>
+#include <filesystem>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Milliseconds between checks of modification times.
+constexpr Uint64 MTIME_POLL_INTERVAL = 500;
+
+/**
+ * Returns the modification time of path, or 0 if it cannot be read.
+ */
+static long long get_mtime(const std::string& path) {
+	std::error_code ec;
+	const auto time = std::filesystem::last_write_time(path, ec);
+	return ec ? 0 : static_cast<long long>(time.time_since_epoch().count());
+}
+
+static void add_changed(std::vector<std::string>& changed, const std::string& path) {
+	if (std::find(changed.begin(), changed.end(), path) == changed.end()) {
+		changed.push_back(path);
+	}
+}
+
+FileWatcher::FileWatcher() {
+#ifdef __linux__
+	notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+	if (notify_fd >= 0) close(notify_fd);
+#endif
+}
+
+void FileWatcher::watch(const std::string& path) {
+	for (const WatchedFile& file : files) {
+		if (file.path == path) return;
+	}
+	const std::filesystem::path fs_path(path);
+	std::string dir = fs_path.parent_path().string();
+	if (dir.empty()) dir = ".";
+	int wd = -1;
+#ifdef __linux__
+	if (notify_fd >= 0) {
+		// Watching the same directory again returns the same descriptor.
+		wd = inotify_add_watch(notify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	}
+#endif
+	files.push_back({path, fs_path.filename().string(), wd, get_mtime(path)});
+}
+
+void FileWatcher::poll(std::vector<std::string>& changed) {
+#ifdef __linux__
+	if (notify_fd >= 0) {
+		alignas(inotify_event) char buffer[4096];
+		while (true) {
+			const ssize_t len = read(notify_fd, buffer, sizeof(buffer));
+			if (len <= 0) break;
+			for (ssize_t i = 0; i < len;) {
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + i);
+				i += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+				if (event->len == 0) continue;
+				for (const WatchedFile& file : files) {
+					if (file.watch_descriptor == event->wd && file.name == event->name) {
+						add_changed(changed, file.path);
+					}
+				}
+			}
+		}
+		// Files in directories that could not be watched are polled.
+		if (std::none_of(files.begin(), files.end(), [](const WatchedFile& f) {return f.watch_descriptor < 0;})) {
+			return;
+		}
+	}
+#endif
+	poll_mtimes(changed);
+}
+
+void FileWatcher::poll_mtimes(std::vector<std::string>& changed) {
+	const Uint64 now = SDL_GetTicks64();
+	if (now - last_poll < MTIME_POLL_INTERVAL) return;
+	last_poll = now;
+	for (WatchedFile& file : files) {
+		if (file.watch_descriptor >= 0) continue;
+		const long long mtime = get_mtime(file.path);
+		if (mtime != file.mtime) {
+			file.mtime = mtime;
+			add_changed(changed, file.path);
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef FILE_WATCHER_00_H
+#define FILE_WATCHER_00_H
+#include <string>
+#include <vector>
+#include <SDL.h>
+
+/**
+ * Watches files for changes. On Linux inotify is used on the directories of the watched files,
+ * so that files replaced by renaming are noticed as well.
+ * Elsewhere, or if inotify is not available, modification times are checked a few times per second.
+ */
+class FileWatcher {
+	public:
+		FileWatcher();
+
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		~FileWatcher();
+
+		/**
+		 * Starts watching path. Watching a path that is already watched does nothing.
+		 */
+		void watch(const std::string& path);
+
+		/**
+		 * Appends every watched path that has changed since the last call to changed, each at most once.
+		 * Never blocks.
+		 */
+		void poll(std::vector<std::string>& changed);
+
+	private:
+		struct WatchedFile {
+			std::string path;
+			std::string name;
+			int watch_descriptor;
+			long long mtime;
+		};
+
+		/**
+		 * Checks modification times, used when inotify is not available.
+		 */
+		void poll_mtimes(std::vector<std::string>& changed);
+
+		std::vector<WatchedFile> files;
+
+		// inotify instance, or -1 if modification times are polled instead.
+		int notify_fd = -1;
+		Uint64 last_poll = 0;
+};
+
+#endif
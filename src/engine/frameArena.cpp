@@ -0,0 +1,70 @@
+#include "frameArena.h"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+FrameArena::FrameArena(const size_t size) {
+	blocks.push_back({std::unique_ptr<unsigned char[]>(new unsigned char[size]), size});
+}
+
+void* FrameArena::allocate(const size_t size, const size_t alignment) {
+	while (true) {
+		if (current == blocks.size()) {
+			// A block for the rest of the frame, merged with the others on reset.
+			const size_t block_size = std::max(size + alignment, blocks.back().size);
+			blocks.push_back({std::unique_ptr<unsigned char[]>(new unsigned char[block_size]), block_size});
+		}
+		Block& block = blocks[current];
+		const uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+		const size_t start = ((base + offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1)) - base;
+		if (start + size <= block.size) {
+			offset = start + size;
+			return block.data.get() + start;
+		}
+		used_before += offset;
+		++current;
+		offset = 0;
+	}
+}
+
+void FrameArena::deallocate(void* const p, const size_t size) {
+	if (current < blocks.size() && static_cast<unsigned char*>(p) + size == blocks[current].data.get() + offset) {
+		offset -= size;
+	}
+}
+
+void FrameArena::reset() {
+	high_water = std::max(high_water, get_used());
+	if (blocks.size() > 1) {
+		const size_t size = get_capacity();
+		blocks.clear();
+		blocks.push_back({std::unique_ptr<unsigned char[]>(new unsigned char[size]), size});
+#ifndef NDEBUG
+		std::cout << "Frame arena grown to " << size << " bytes, high water mark " << high_water << " bytes" << std::endl;
+#endif
+	}
+	current = 0;
+	offset = 0;
+	used_before = 0;
+}
+
+size_t FrameArena::get_used() const {
+	return used_before + offset;
+}
+
+size_t FrameArena::get_high_water() const {
+	return high_water;
+}
+
+size_t FrameArena::get_capacity() const {
+	size_t size = 0;
+	for (const Block& block : blocks) {
+		size += block.size;
+	}
+	return size;
+}
+
+FrameArena& engine::frame_arena() {
+	thread_local FrameArena arena;
+	return arena;
+}
@@ -0,0 +1,125 @@
+#ifndef FRAME_ARENA_00_H
+#define FRAME_ARENA_00_H
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * Bump allocator for memory that only lives until the end of a frame.
+ * Allocating moves a pointer forward and freeing does nothing, until reset makes all of the memory available again.
+ * When a frame needs more than the arena holds, extra blocks are allocated for it, and reset replaces all blocks
+ * with a single one large enough for that frame, so that a steady frame does not touch the heap at all.
+ */
+class FrameArena {
+	public:
+		static constexpr size_t DEFAULT_SIZE = 64 * 1024;
+
+		explicit FrameArena(size_t size = DEFAULT_SIZE);
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		/**
+		 * Returns size bytes aligned to alignment, which must be a power of two. Never returns nullptr.
+		 */
+		void* allocate(size_t size, size_t alignment);
+
+		/**
+		 * Gives back the memory at p if it was the last allocation, so that a growing vector can reuse it.
+		 * Otherwise it is kept until reset.
+		 */
+		void deallocate(void* p, size_t size);
+
+		/**
+		 * Frees everything allocated since the last reset.
+		 */
+		void reset();
+
+		/**
+		 * Returns the number of bytes allocated since the last reset, including alignment padding.
+		 */
+		[[nodiscard]] size_t get_used() const;
+
+		/**
+		 * Returns the most bytes used in a single frame so far.
+		 */
+		[[nodiscard]] size_t get_high_water() const;
+
+		/**
+		 * Returns the number of bytes held by the arena.
+		 */
+		[[nodiscard]] size_t get_capacity() const;
+
+	private:
+		struct Block {
+			std::unique_ptr<unsigned char[]> data;
+			size_t size;
+		};
+
+		std::vector<Block> blocks;
+		// Index of the block allocated from and the offset into it.
+		size_t current = 0;
+		size_t offset = 0;
+		// Bytes used in the blocks before current.
+		size_t used_before = 0;
+		size_t high_water = 0;
+};
+
+namespace engine {
+	/**
+	 * Returns the frame arena of the calling thread. Game::run resets the arena of the main thread after every frame,
+	 * and the simulation thread of a StateGame resets its own after every tick. Job workers never reset theirs,
+	 * so tasks should not allocate from it.
+	 */
+	FrameArena& frame_arena();
+}
+
+/**
+ * Allocator handing out memory of a FrameArena, for containers that do not outlive the frame.
+ * Containers using it may not be kept past a reset of the arena.
+ */
+template<class T>
+class FrameAllocator {
+	public:
+		using value_type = T;
+
+		/**
+		 * Allocates from the frame arena of the calling thread.
+		 */
+		FrameAllocator() noexcept : arena(&engine::frame_arena()) {}
+
+		explicit FrameAllocator(FrameArena& arena) noexcept : arena(&arena) {}
+
+		template<class U>
+		FrameAllocator(const FrameAllocator<U>& o) noexcept : arena(o.get_arena()) {} // NOLINT(google-explicit-constructor)
+
+		T* allocate(const size_t n) {
+			return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* const p, const size_t n) noexcept {
+			arena->deallocate(p, n * sizeof(T));
+		}
+
+		[[nodiscard]] FrameArena* get_arena() const noexcept {
+			return arena;
+		}
+
+		template<class U>
+		bool operator==(const FrameAllocator<U>& o) const noexcept {
+			return arena == o.get_arena();
+		}
+
+		template<class U>
+		bool operator!=(const FrameAllocator<U>& o) const noexcept {
+			return arena != o.get_arena();
+		}
+
+	private:
+		FrameArena* arena;
+};
+
+template<class T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif
@@ -0,0 +1,91 @@
+#include "frameStats.h"
+#include <algorithm>
+#include <cmath>
+#include <SDL.h>
+
+static const char* const PHASE_NAMES[] = {"event", "tick", "render", "present", "frame"};
+
+int FrameStats::bucket_of(const double seconds) {
+	const double us = seconds * 1e6;
+	if (us < 1.0) return 0;
+	const int bucket = static_cast<int>(std::log2(us) * BUCKETS_PER_OCTAVE) + 1;
+	return std::min(bucket, BUCKET_COUNT - 1);
+}
+
+double FrameStats::bucket_time(const int bucket) {
+	if (bucket == 0) return 0.0005;
+	return std::exp2((bucket - 0.5) / BUCKETS_PER_OCTAVE) / 1000.0;
+}
+
+void FrameStats::record(const FramePhase phase, const double seconds) {
+	current[static_cast<int>(phase)] = seconds;
+}
+
+void FrameStats::end_frame() {
+	for (int phase = 0; phase < PHASES; ++phase) {
+		if (count == WINDOW) {
+			--buckets[phase][bucket_of(samples[phase][next])];
+		}
+		samples[phase][next] = current[phase];
+		++buckets[phase][bucket_of(current[phase])];
+		current[phase] = 0.0;
+	}
+	next = (next + 1) % WINDOW;
+	if (count < WINDOW) ++count;
+}
+
+int FrameStats::frame_count() const {
+	return count;
+}
+
+double FrameStats::percentile(const int phase, const double fraction) const {
+	const int target = static_cast<int>(std::ceil(fraction * count));
+	int seen = 0;
+	for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+		seen += buckets[phase][bucket];
+		if (seen >= target && seen > 0) return bucket_time(bucket);
+	}
+	return 0.0;
+}
+
+FrameTimeSummary FrameStats::summary(const FramePhase phase) const {
+	const int p = static_cast<int>(phase);
+	const double max = count == 0 ? 0.0 : *std::max_element(samples[p].begin(), samples[p].begin() + count) * 1000.0;
+	// Buckets only give the middle of a range, which can be above the largest time in it.
+	return {
+		std::min(percentile(p, 0.50), max),
+		std::min(percentile(p, 0.95), max),
+		std::min(percentile(p, 0.99), max),
+		max
+	};
+}
+
+bool FrameStats::write_csv(const std::string& path) const {
+	SDL_RWops* file = SDL_RWFromFile(path.c_str(), "w");
+	if (file == nullptr) return false;
+	std::string csv = "phase,p50_ms,p95_ms,p99_ms,max_ms\n";
+	for (int phase = 0; phase < PHASES; ++phase) {
+		const FrameTimeSummary s = summary(static_cast<FramePhase>(phase));
+		csv += std::string(PHASE_NAMES[phase]) + ',' + std::to_string(s.p50) + ',' + std::to_string(s.p95) + ',' +
+			std::to_string(s.p99) + ',' + std::to_string(s.max) + '\n';
+	}
+	csv += "\nbucket_ms";
+	for (const char* name : PHASE_NAMES) {
+		csv += ',' + std::string(name);
+	}
+	csv += '\n';
+	for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+		bool empty = true;
+		for (int phase = 0; phase < PHASES; ++phase) {
+			if (buckets[phase][bucket] != 0) empty = false;
+		}
+		if (empty) continue;
+		csv += std::to_string(bucket_time(bucket));
+		for (int phase = 0; phase < PHASES; ++phase) {
+			csv += ',' + std::to_string(buckets[phase][bucket]);
+		}
+		csv += '\n';
+	}
+	const bool ok = SDL_RWwrite(file, csv.data(), 1, csv.size()) == csv.size();
+	return SDL_RWclose(file) == 0 && ok;
+}
@@ -0,0 +1,80 @@
+#ifndef FRAME_STATS_00_H
+#define FRAME_STATS_00_H
+#include <array>
+#include <string>
+
+/**
+ * Parts of a frame that are timed separately. FRAME is the whole frame.
+ */
+enum class FramePhase {
+	EVENT, TICK, RENDER, PRESENT, FRAME, TOTAL
+};
+
+/**
+ * Percentiles and maximum of the times of one phase, in milliseconds.
+ */
+struct FrameTimeSummary {
+	double p50;
+	double p95;
+	double p99;
+	double max;
+};
+
+/**
+ * Rolling histogram of frame times over the last WINDOW frames.
+ * Buckets are logarithmic, so percentiles are accurate to a few percent from microseconds to seconds.
+ */
+class FrameStats {
+	public:
+		static constexpr int WINDOW = 1024;
+
+		/**
+		 * Sets the time of phase in the current frame, in seconds.
+		 */
+		void record(FramePhase phase, double seconds);
+
+		/**
+		 * Adds the current frame to the histogram, dropping the oldest frame once WINDOW frames have been added.
+		 */
+		void end_frame();
+
+		/**
+		 * Returns the number of frames in the histogram.
+		 */
+		[[nodiscard]] int frame_count() const;
+
+		/**
+		 * Returns the percentiles and maximum of phase over the frames in the histogram.
+		 */
+		[[nodiscard]] FrameTimeSummary summary(FramePhase phase) const;
+
+		/**
+		 * Writes the summary of every phase followed by the histogram to path as CSV. Returns false if writing fails.
+		 */
+		bool write_csv(const std::string& path) const;
+
+	private:
+		static constexpr int BUCKETS_PER_OCTAVE = 8;
+		// 1 microsecond to about 16 seconds.
+		static constexpr int BUCKET_COUNT = 24 * BUCKETS_PER_OCTAVE + 2;
+		static constexpr int PHASES = static_cast<int>(FramePhase::TOTAL);
+
+		static int bucket_of(double seconds);
+
+		/**
+		 * Returns the time in the middle of bucket, in milliseconds.
+		 */
+		static double bucket_time(int bucket);
+
+		[[nodiscard]] double percentile(int phase, double fraction) const;
+
+		std::array<double, PHASES> current{};
+
+		// Times of the frames in the window, in seconds, oldest at next once the window is full.
+		std::array<std::array<double, WINDOW>, PHASES> samples{};
+		std::array<std::array<int, BUCKET_COUNT>, PHASES> buckets{};
+		int next = 0;
+		int count = 0;
+};
+
+#endif
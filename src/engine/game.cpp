@@ -1,7 +1,17 @@
 #include "game.h"
+#include "frameArena.h"
+#include "glyphAtlas.h"
+#include "profiler.h"
+#include "renderQueue.h"
+#include "jobs.h"
+#include "replay.h"
+#include <cstring>
 #include <iostream>
 #include <utility>
 
+// Seconds between ticks on the simulation thread.
+constexpr double SIMULATION_TICK_INTERVAL = 0.004;
+
 SDL_Renderer* gRenderer;
 SDL_Window* gWindow;
 
@@ -43,7 +53,7 @@ void Game::create() {
 		throw SDL_exception("Renderer could not be created, " + std::string(SDL_GetError()));
 	}
 	
-	SDL_RenderSetVSync(gRenderer, 1);
+	vsync = SDL_RenderSetVSync(gRenderer, 1) == 0;
 	SDL_SetRenderDrawBlendMode(gRenderer, SDL_BLENDMODE_BLEND);
 	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 
@@ -61,12 +71,20 @@ void Game::run() {
 		return;
 	}
 	running = true;
-	Uint64 last_time = SDL_GetTicks64();
+	const double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+	Uint64 last_time = SDL_GetPerformanceCounter();
 	
 	while (true) {
+		if (is_idle()) {
+			// Leaves the event in the queue, the timeout lets invalidations and main thread tasks through.
+			SDL_WaitEventTimeout(nullptr, IDLE_TIMEOUT_MS);
+		}
+		PROFILE_ZONE("Game::run");
+		const Uint64 frame_start = SDL_GetPerformanceCounter();
 		SDL_Event e;
 		while (SDL_PollEvent(&e)) 
 		{
+			PROFILE_ZONE("Game::run event");
 			switch (e.type) {
 				case SDL_QUIT:
 					exit_game();
@@ -89,13 +107,59 @@ void Game::run() {
 			}
 		}
 		window_state.mouse_mask = SDL_GetMouseState(&window_state.mouseX, &window_state.mouseY);
-		Uint64 cur_time = SDL_GetTicks64();
-		this->tick(cur_time - last_time);
+		engine::run_main_thread_tasks();
+		const Uint64 cur_time = SDL_GetPerformanceCounter();
+		this->tick(static_cast<double>(cur_time - last_time) / frequency);
+		const Uint64 tick_end = SDL_GetPerformanceCounter();
 		if (!running) break;
 		last_time = cur_time;
 		
-		render();
+		{
+			PROFILE_ZONE("Game::run render");
+			render();
+			gRenderQueue.flush();
+		}
+		const Uint64 render_end = SDL_GetPerformanceCounter();
+		{
+			PROFILE_ZONE("Game::run present");
+			present();
+		}
+		const Uint64 present_end = SDL_GetPerformanceCounter();
+
+		frame_stats.record(FramePhase::EVENT, static_cast<double>(cur_time - frame_start) / frequency);
+		frame_stats.record(FramePhase::TICK, static_cast<double>(tick_end - cur_time) / frequency);
+		frame_stats.record(FramePhase::RENDER, static_cast<double>(render_end - tick_end) / frequency);
+		frame_stats.record(FramePhase::PRESENT, static_cast<double>(present_end - render_end) / frequency);
+		frame_stats.record(FramePhase::FRAME, static_cast<double>(present_end - frame_start) / frequency);
+		frame_stats.end_frame();
+		gRenderQueue.end_frame();
+		engine::frame_arena().reset();
+
+		if (!vsync || !is_vsynced()) {
+			const double left = 1.0 / MAX_UNSYNCED_FPS - static_cast<double>(SDL_GetPerformanceCounter() - frame_start) / frequency;
+			if (left > 0.0) {
+				SDL_Delay(static_cast<Uint32>(left * 1000.0));
+			}
+		}
 	}
+#ifndef NDEBUG
+	std::cout << "Frame arena high water mark " << engine::frame_arena().get_high_water() << " bytes" << std::endl;
+#endif
+	if (!frame_stats_file.empty() && !frame_stats.write_csv(frame_stats_file)) {
+		std::cout << "Could not write frame stats to " << frame_stats_file << ", " << SDL_GetError() << std::endl;
+	}
+}
+
+void Game::present() {
+	SDL_RenderPresent(gRenderer);
+}
+
+const FrameStats& Game::get_frame_stats() const {
+	return frame_stats;
+}
+
+void Game::set_frame_stats_file(std::string path) {
+	frame_stats_file = std::move(path);
 }
 
 void Game::exit_game() {
@@ -104,6 +168,8 @@ void Game::exit_game() {
 
 Game::~Game() {
     if (!destroyed) {
+        // Subclasses have destroyed their textboxes by now, so the atlas textures can go before the renderer.
+        free_glyph_atlases();
         SDL_DestroyRenderer(gRenderer);
         gRenderer = nullptr;
 
@@ -116,10 +182,38 @@ Game::~Game() {
  * State class
  *
  */ 
+std::unique_ptr<engine::TaskGroup> State::load() {
+	return nullptr;
+}
+
 void State::init(WindowState* state) {
 	window_state = state;
 }
 
+void State::present() {
+	SDL_RenderPresent(gRenderer);
+}
+
+bool State::is_threaded() const {
+	return false;
+}
+
+bool State::is_recordable() const {
+	return false;
+}
+
+bool State::is_idle() const {
+	return false;
+}
+
+bool State::is_vsynced() const {
+	return true;
+}
+
+Uint64 State::hash_state() const {
+	return 0;
+}
+
 int State::get_preferred_width() const {
 	return -1;
 }
@@ -140,29 +234,192 @@ StateGame::StateGame(State* initial_state, const int w, const int h, const std::
 	states.emplace(initial_state);
 }
 
+StateGame::~StateGame() {
+	stop_simulation();
+	stop_recording();
+	// The loading tasks may use the state, so they are waited for first.
+	loading.reset();
+	delete loading_status.new_state;
+	if (simulation_done) {
+		// A state change signaled just before exiting was never applied.
+		delete simulation_status.new_state;
+	}
+	// The states hold atlases, which Game::~Game frees along with the renderer.
+	while (!states.empty()) {
+		states.pop();
+	}
+}
+
+void StateGame::set_invalidation_source(std::function<void(std::vector<std::string>&)> source) {
+	invalidation_source = std::move(source);
+}
+
+void StateGame::set_threaded(const bool use_threads) {
+	threaded = use_threads;
+}
+
+void StateGame::set_recording_file(std::string path) {
+	recording_file = std::move(path);
+}
+
 void StateGame::init() {
+	std::unique_ptr<engine::TaskGroup> group = states.top()->load();
+	if (group != nullptr) {
+		group->wait();
+	}
 	update_window(states.top().get());
-	states.top()->init(&window_state);
+	init_state(states.top().get());
+}
+
+void StateGame::init_state(State* const state) {
+	if (threaded && state->is_threaded()) {
+		simulation_window_state = window_state;
+		if (window_state.keyboard_state != nullptr) {
+			memcpy(simulation_keys.data(), window_state.keyboard_state, SDL_NUM_SCANCODES);
+		}
+		simulation_window_state.keyboard_state = simulation_keys.data();
+		state->init(&simulation_window_state);
+		start_recording(state, simulation_window_state);
+	} else {
+		state->init(&window_state);
+		start_recording(state, window_state);
+	}
+}
+
+void StateGame::start_recording(const State* const state, const WindowState& state_window) {
+	if (recording_file.empty() || !state->is_recordable()) return;
+	try {
+		recorder = std::make_unique<InputRecorder>(recording_file, state_window);
+		recorded_state = state;
+	} catch (const base_exception& e) {
+		std::cout << "Could not start recording, " << e.msg << std::endl;
+	}
+}
+
+void StateGame::stop_recording() {
+	if (recorder == nullptr) return;
+	if (!recorder->flush()) {
+		std::cout << "Could not write recording to " << recording_file << ", " << SDL_GetError() << std::endl;
+	}
+	recorder.reset();
+	recorded_state = nullptr;
 }
 
 void StateGame::render() {
 	states.top()->render();
 }
 
-void StateGame::tick(Uint64 delta) {
+void StateGame::present() {
+	states.top()->present();
+}
+
+bool StateGame::is_idle() const {
+	return loading == nullptr && !simulation.joinable() && states.top()->is_idle();
+}
+
+bool StateGame::is_vsynced() const {
+	return states.top()->is_vsynced();
+}
+
+void StateGame::tick(double delta) {
+	PROFILE_ZONE("StateGame::tick");
+	if (loading != nullptr) {
+		// The top state is only rendered while the next one loads, and config is not reloaded under it.
+		if (loading->is_done()) {
+			finish_loading();
+		}
+		return;
+	}
+	if (simulation.joinable() && simulation_done) {
+		// The simulation thread stopped to signal a state change.
+		stop_simulation();
+		// Taken out first, since the new state is owned by the stack or the loading status from now on.
+		const StateStatus status = simulation_status;
+		simulation_status = {StateStatus::NONE, nullptr};
+		apply_status(status);
+		return;
+	}
+	if (invalidation_source) {
+		invalidated.clear();
+		invalidation_source(invalidated);
+		if (!invalidated.empty()) {
+			// Pauses the simulation thread, if it is running.
+			std::lock_guard<std::mutex> lock(tick_mutex);
+			states.top()->invalidate(invalidated);
+		}
+	}
+	if (simulation.joinable()) {
+		std::lock_guard<std::mutex> lock(input_mutex);
+		input_window_state = window_state;
+		memcpy(input_keys.data(), window_state.keyboard_state, SDL_NUM_SCANCODES);
+		return;
+	}
+	if (threaded && states.top()->is_threaded()) {
+		start_simulation();
+		return;
+	}
 	StateStatus status = {StateStatus::NONE, nullptr};
+	const bool recording = recorder != nullptr && states.top().get() == recorded_state;
+	if (recording) {
+		recorder->record_window(window_state);
+	}
 	states.top()->tick(delta, status);
+	if (recording) {
+		recorder->record_tick(delta, states.top()->hash_state());
+	}
+	states.top()->publish();
+	apply_status(status);
+}
 
+void StateGame::apply_status(const StateStatus& status) {
+	if (status.action != StateStatus::NONE) {
+		stop_recording();
+	}
+	if (status.action == StateStatus::PUSH || status.action == StateStatus::SWAP) {
+		std::unique_ptr<engine::TaskGroup> group;
+		try {
+			group = status.new_state->load();
+		} catch (...) {
+			delete status.new_state;
+			throw;
+		}
+		if (group != nullptr) {
+			loading = std::move(group);
+			loading_status = status;
+			if (loading->is_done()) {
+				finish_loading();
+			}
+			return;
+		}
+	}
+	change_state(status);
+}
+
+void StateGame::finish_loading() {
+	const StateStatus status = loading_status;
+	loading_status = {StateStatus::NONE, nullptr};
+	try {
+		loading->wait();
+	} catch (...) {
+		loading.reset();
+		delete status.new_state;
+		throw;
+	}
+	loading.reset();
+	change_state(status);
+}
+
+void StateGame::change_state(const StateStatus& status) {
 	switch (status.action) {
 		case StateStatus::PUSH:
 			states.emplace(status.new_state);
 			update_window(status.new_state);
-			states.top()->init(&window_state);
+			init_state(status.new_state);
 			break;
 		case StateStatus::SWAP:
 			states.top().reset(status.new_state);
 			update_window(status.new_state);
-			states.top()->init(&window_state);
+			init_state(status.new_state);
 			break;
 		case StateStatus::POP:
 			states.pop();
@@ -181,6 +438,72 @@ void StateGame::tick(Uint64 delta) {
     }
 }
 
+void StateGame::start_simulation() {
+	stop_requested = false;
+	simulation_done = false;
+	simulation_status = {StateStatus::NONE, nullptr};
+	{
+		std::lock_guard<std::mutex> lock(input_mutex);
+		input_events.clear();
+		input_window_state = window_state;
+		memcpy(input_keys.data(), window_state.keyboard_state, SDL_NUM_SCANCODES);
+	}
+	simulation = std::thread(&StateGame::simulate, this);
+}
+
+void StateGame::stop_simulation() {
+	if (!simulation.joinable()) return;
+	stop_requested = true;
+	simulation.join();
+}
+
+void StateGame::simulate() {
+	profiler::set_thread_name("simulation");
+	State* const state = states.top().get();
+	const double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+	Uint64 last_time = SDL_GetPerformanceCounter();
+	while (!stop_requested) {
+		const Uint64 cur_time = SDL_GetPerformanceCounter();
+		const double delta = static_cast<double>(cur_time - last_time) / frequency;
+		if (delta < SIMULATION_TICK_INTERVAL) {
+			SDL_Delay(1);
+			continue;
+		}
+		StateStatus status = {StateStatus::NONE, nullptr};
+		{
+			PROFILE_ZONE("StateGame::tick");
+			std::lock_guard<std::mutex> tick_lock(tick_mutex);
+			{
+				std::lock_guard<std::mutex> input_lock(input_mutex);
+				simulation_events.swap(input_events);
+				simulation_window_state = input_window_state;
+				simulation_keys = input_keys;
+			}
+			simulation_window_state.keyboard_state = simulation_keys.data();
+			if (recorder != nullptr && state == recorded_state) {
+				recorder->record_window(simulation_window_state);
+			}
+			for (SDL_Event& e : simulation_events) {
+				dispatch_event(state, e);
+			}
+			simulation_events.clear();
+			state->tick(delta, status);
+			if (recorder != nullptr && state == recorded_state) {
+				recorder->record_tick(delta, state->hash_state());
+			}
+			state->publish();
+		}
+		engine::frame_arena().reset();
+		last_time = cur_time;
+		if (status.action != StateStatus::NONE) {
+			// The main thread changes states, since new states may need the renderer in init.
+			simulation_status = status;
+			simulation_done = true;
+			return;
+		}
+	}
+}
+
 void StateGame::update_window(const State* const state) {
 	int w = state->get_preferred_width(), h = state->get_preferred_height();
 	if (w == -1) w = window_state.screen_width;
@@ -192,22 +515,69 @@ void StateGame::update_window(const State* const state) {
 	}
 }
 
+void StateGame::dispatch_event(State* const state, SDL_Event& e) {
+	if (recorder != nullptr && state == recorded_state) {
+		recorder->record_event(e);
+	}
+	switch (e.type) {
+		case SDL_KEYDOWN:
+			state->handle_down(e.key.keysym.sym, 0);
+			break;
+		case SDL_KEYUP:
+			state->handle_up(e.key.keysym.sym, 0);
+			break;
+		case SDL_MOUSEBUTTONDOWN:
+			state->handle_down(SDLK_UNKNOWN, e.button.button);
+			break;
+		case SDL_MOUSEBUTTONUP:
+			state->handle_up(SDLK_UNKNOWN, e.button.button);
+			break;
+		case SDL_MOUSEWHEEL:
+			state->handle_wheel(e.wheel);
+			break;
+	}
+}
+
+void StateGame::handle_event(SDL_Event& e) {
+	if (loading != nullptr) {
+		// The top state is not ticked while the next one loads. A state change it signaled now
+		// would wait until it is on top again, and then apply out of the blue.
+		return;
+	}
+	if (simulation.joinable() && !simulation_done) {
+		std::lock_guard<std::mutex> lock(input_mutex);
+		input_events.push_back(e);
+	} else {
+		dispatch_event(states.top().get(), e);
+	}
+}
+
 void StateGame::handle_keydown(SDL_KeyboardEvent &e) {
-	states.top()->handle_down(e.keysym.sym, 0);
+	SDL_Event event;
+	event.key = e;
+	handle_event(event);
 }
 
 void StateGame::handle_keyup(SDL_KeyboardEvent &e) {
-	states.top()->handle_up(e.keysym.sym, 0);
+	SDL_Event event;
+	event.key = e;
+	handle_event(event);
 }
 
 void StateGame::handle_mousedown(SDL_MouseButtonEvent &e) {
-	states.top()->handle_down(SDLK_UNKNOWN, e.button);
+	SDL_Event event;
+	event.button = e;
+	handle_event(event);
 }
 
 void StateGame::handle_mouseup(SDL_MouseButtonEvent &e) {
-	states.top()->handle_up(SDLK_UNKNOWN, e.button);
+	SDL_Event event;
+	event.button = e;
+	handle_event(event);
 }
 
 void StateGame::handle_mousewheel(SDL_MouseWheelEvent &e) {
-	states.top()->handle_wheel(e);
-}
\ No newline at end of file
+	SDL_Event event;
+	event.wheel = e;
+	handle_event(event);
+}
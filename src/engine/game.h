@@ -1,12 +1,22 @@
 #ifndef GAME_00_H
 #define GAME_00_H
+#include <array>
+#include <atomic>
+#include <functional>
+#include <iosfwd>
 #include <memory>
+#include <mutex>
 #include <stack>
+#include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 #include <SDL.h>
 #include "util/exceptions.h"
 #include "texture.h"
 #include "engine.h"
+#include "frameStats.h"
+#include "jobs.h"
 
 /**
  * Game_exception, when creating a game fails (for example when one is already running).
@@ -55,6 +65,7 @@ class Game {
 		 * Starts and runs the game loop, calling tick and render every frame and handle_keydown / handle_keyup when a keypress happens.
 		 * Will return after exit_game has been called, or immediately if the game has not been created or has been destroyed.
 		 * Closing the window will call exit_game and cause run to return.
+		 * While the game is_idle, run sleeps until an event arrives instead of starting frames back to back.
 		 */
 		void run();
 		
@@ -62,6 +73,16 @@ class Game {
 		 * Exits an ongoing game.
 		 */
 		void exit_game();
+
+		/**
+		 * Returns the times of the most recent frames.
+		 */
+		[[nodiscard]] const FrameStats& get_frame_stats() const;
+
+		/**
+		 * Sets a file the frame time histogram is written to as CSV when run returns.
+		 */
+		void set_frame_stats_file(std::string path);
 		
 	protected:
 		WindowState window_state{};
@@ -72,15 +93,32 @@ class Game {
 		 */
 		virtual void render() {};
 
+		/**
+		 * Called once per frame after render, shows the rendered frame.
+		 */
+		virtual void present();
+
+		/**
+		 * Returns true if nothing changes until the next event. Run then waits for an event,
+		 * or IDLE_TIMEOUT_MS to pass, before starting the next frame.
+		 */
+		[[nodiscard]] virtual bool is_idle() const { return false; };
+
+		/**
+		 * Returns true if present waits for vsync, given that the renderer supports it.
+		 * Other frames are capped at MAX_UNSYNCED_FPS.
+		 */
+		[[nodiscard]] virtual bool is_vsynced() const { return true; };
+
 		/**
 		 * Initializes a game, called at the end of create. If init trows an exception the game will not be successfully created.
 		 */
 		virtual void init() {};
 
 		/**
-		 * Tick function, called once every frame, before render. Delta is the passed time in milliseconds.
+		 * Tick function, called once every frame, before render. Delta is the passed time in seconds.
 		 */
-		virtual void tick(Uint64 delta) {};
+		virtual void tick(double delta) {};
 
 		/**
 		 * Called every time a KEYDOWN-event happens.
@@ -108,11 +146,19 @@ class Game {
 		 virtual void handle_mousewheel(SDL_MouseWheelEvent &e) {};
 
 	private:
+		static constexpr int IDLE_TIMEOUT_MS = 250;
+		static constexpr int MAX_UNSYNCED_FPS = 60;
+
 		bool running = false;
 		bool destroyed = true;
+		// If the renderer waits for vsync when presenting.
+		bool vsync = false;
 
 		const int initial_width = 100, initial_height = 100;
 		const std::string initial_title = "Title";
+
+		FrameStats frame_stats;
+		std::string frame_stats_file;
 };
 
 class State;
@@ -136,8 +182,17 @@ class State {
 
 		State() : window_state(nullptr) {};
 
+		virtual ~State() = default;
+
 		/**
-		 * Initializes this state.
+		 * Starts the work needed before init that can run off the main thread, like reading files and decoding images.
+		 * A StateGame keeps rendering the current state until the returned group is done, and calls init after that.
+		 * The tasks may not use the renderer or the window. Returns nullptr if there is nothing to load.
+		 */
+		virtual std::unique_ptr<engine::TaskGroup> load();
+
+		/**
+		 * Initializes this state, after anything started by load is done.
 		 */
 		virtual void init(WindowState* window_state);
 		
@@ -147,15 +202,49 @@ class State {
 		virtual void resume() {};
 
 		/**
-		 * Ticks the state, with a time-step delta. The parameter res is used to signal a change of state.
+		 * Ticks the state, with a time-step delta in seconds. The parameter res is used to signal a change of state.
 		 */
-		virtual void tick(const Uint64 delta, StateStatus& res) {};
+		virtual void tick(const double delta, StateStatus& res) {};
 
 		/**
 		 * Renders the state.
 		 */
 		virtual void render() {};
 
+		/**
+		 * Shows what render drew, by default by presenting the renderer.
+		 */
+		virtual void present();
+
+		/**
+		 * Returns true if the state only changes on input, so the game can sleep until an event arrives.
+		 * An idle state is still ticked and rendered after events and every so often without them.
+		 */
+		[[nodiscard]] virtual bool is_idle() const;
+
+		/**
+		 * Returns true if present goes through the renderer and so waits for vsync.
+		 */
+		[[nodiscard]] virtual bool is_vsynced() const;
+
+		/**
+		 * Called after every tick, on the thread that ticked. A threaded state copies what render needs here.
+		 */
+		virtual void publish() {};
+
+		/**
+		 * Returns true if this state can be ticked on the simulation thread of a threaded StateGame.
+		 * Such a state may only use the renderer in render, and render may only read what publish wrote
+		 * and data that is changed in init, resume or invalidate.
+		 */
+		[[nodiscard]] virtual bool is_threaded() const;
+
+		/**
+		 * Returns true if the input of this state can be recorded and replayed, see InputRecorder.
+		 * Such a state must only depend on its input and the loaded config, in both threaded and unthreaded mode.
+		 */
+		[[nodiscard]] virtual bool is_recordable() const;
+
 		/**
 		 * Called when a down event (mouse or keyboard) happens.
 		 */
@@ -171,6 +260,23 @@ class State {
 		 */
 		virtual void handle_wheel(const SDL_MouseWheelEvent &e) {};
 
+		/**
+		 * Called between ticks with the keys of cached data that changed on disk.
+		 * A state holding on to any of it should load it again.
+		 */
+		virtual void invalidate(const std::vector<std::string>& keys) {};
+
+		/**
+		 * Writes a human readable summary of the simulated state, used to compare replays.
+		 */
+		virtual void report(std::ostream& os) const {};
+
+		/**
+		 * Returns a hash of everything tick depends on, to find the first tick where two runs diverge.
+		 * States that are not simulated return 0.
+		 */
+		[[nodiscard]] virtual Uint64 hash_state() const;
+
 		/**
 		 * Get the desired window width of this state.
 		 */
@@ -190,10 +296,34 @@ class State {
  * Game class containing a stack of states. Render, tick and events are passed onto the top state.
  * The state call to tick can signal adding new states or removing them.
  */
+class InputRecorder;
+
 class StateGame : public Game {
 	public:
 		StateGame(State* state, int w, int h, const std::string& title);
 
+		/**
+		 * Sets a function polled before every tick for keys of invalidated data.
+		 * Keys it appends are given to the top state through State::invalidate.
+		 */
+		void set_invalidation_source(std::function<void(std::vector<std::string>&)> source);
+
+		/**
+		 * Enables or disables threaded mode, must be called before run.
+		 * In threaded mode a top state that is_threaded is ticked on a separate simulation thread at a fixed rate,
+		 * while the main thread handles events and renders the newest published state.
+		 * State changes and invalidations are done on the main thread while the simulation thread is paused.
+		 */
+		void set_threaded(bool threaded);
+
+		/**
+		 * Records the input of states that are_recordable to path, see InputRecorder. Must be called before run.
+		 * Recording stops when the state stops being the top state, and the next such state overwrites the file.
+		 */
+		void set_recording_file(std::string path);
+
+		~StateGame() override;
+
 	protected:
 
 		/**
@@ -206,11 +336,23 @@ class StateGame : public Game {
 		 */
         void render() override;
 
+		/**
+		 * Presents the current top state.
+		 */
+        void present() override;
+
+		/**
+		 * Returns true if the top state is idle and no state is loading or simulated.
+		 */
+        [[nodiscard]] bool is_idle() const override;
+
+        [[nodiscard]] bool is_vsynced() const override;
+
 		/**
 		 * Ticks the current top state, and potentially changes to a new state.
 		 * This is done if the top state signals it.
 		 */
-        void tick(Uint64 delta) override;
+        void tick(double delta) override;
 
 		/**
 		 * Sends a down-event to the top state with the relevant keycode.
@@ -243,9 +385,98 @@ class StateGame : public Game {
 		 * Syncs the screen size with the preferred sizes of state.
 		 */
 		void update_window(const State* state);
+
+		/**
+		 * Changes the state stack as signaled by status, once the new state, if any, has loaded.
+		 */
+		void apply_status(const StateStatus& status);
+
+		/**
+		 * Changes the state stack as signaled by status.
+		 */
+		void change_state(const StateStatus& status);
+
+		/**
+		 * Waits for the loading state and puts it on the state stack.
+		 */
+		void finish_loading();
+
+		/**
+		 * Initializes state, giving it the window state of the thread that will tick it.
+		 */
+		void init_state(State* state);
+
+		/**
+		 * Sends an event to state.
+		 */
+		void dispatch_event(State* state, SDL_Event& e);
+
+		/**
+		 * Sends an event to the top state, or queues it for the simulation thread.
+		 * Events are dropped while a state loads.
+		 */
+		void handle_event(SDL_Event& e);
+
+		/**
+		 * Starts ticking the top state on the simulation thread.
+		 */
+		void start_simulation();
+
+		/**
+		 * Stops the simulation thread and waits for it to finish.
+		 */
+		void stop_simulation();
+
+		/**
+		 * Body of the simulation thread.
+		 */
+		void simulate();
+
+		/**
+		 * Starts recording the input of state, if recording is enabled and state is_recordable.
+		 */
+		void start_recording(const State* state, const WindowState& state_window);
+
+		/**
+		 * Stops recording, writing out what is left.
+		 */
+		void stop_recording();
+
 		// State stack
 		std::stack<std::unique_ptr<State>> states;
-	
+
+		// Loading work of the state in loading_status, which is applied when it is done.
+		std::unique_ptr<engine::TaskGroup> loading;
+		StateStatus loading_status;
+
+		std::function<void(std::vector<std::string>&)> invalidation_source;
+		std::vector<std::string> invalidated;
+
+		bool threaded = false;
+		std::thread simulation;
+		std::atomic<bool> stop_requested{false};
+		// Set by the simulation thread when it stopped to let the main thread apply simulation_status.
+		std::atomic<bool> simulation_done{false};
+		StateStatus simulation_status;
+
+		// Held by the simulation thread while ticking, the main thread holds it to pause the simulation.
+		std::mutex tick_mutex;
+
+		// Input from the main thread waiting for the next simulation tick, guarded by input_mutex.
+		std::mutex input_mutex;
+		std::vector<SDL_Event> input_events;
+		WindowState input_window_state{};
+		std::array<Uint8, SDL_NUM_SCANCODES> input_keys{};
+
+		// The window state seen by a state ticked on the simulation thread.
+		WindowState simulation_window_state{};
+		std::array<Uint8, SDL_NUM_SCANCODES> simulation_keys{};
+		std::vector<SDL_Event> simulation_events;
+
+		std::string recording_file;
+		std::unique_ptr<InputRecorder> recorder;
+		// The state whose input is recorded, only compared against.
+		const State* recorded_state = nullptr;
 };
 
 
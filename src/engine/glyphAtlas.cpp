@@ -0,0 +1,243 @@
+#include "glyphAtlas.h"
+#include <algorithm>
+#include <map>
+#include <utility>
+#include "util/exceptions.h"
+
+/**
+ * An atlas in the cache, with the value of atlas_requests when it was last requested.
+ */
+struct CachedAtlas {
+	std::shared_ptr<GlyphAtlas> atlas;
+	Uint64 last_request;
+};
+
+static std::map<std::pair<TTF_Font*, int>, CachedAtlas> atlases;
+static Uint64 atlas_requests = 0;
+static size_t atlas_budget = 4 * 1024 * 1024;
+
+// Size last set on sized_font. Setting the size of a font flushes its glyph cache, so it is only done when it changes.
+static TTF_Font* sized_font = nullptr;
+static int sized_font_size = 0;
+
+static void set_font_size(TTF_Font* const font, const int size) {
+	if (font == sized_font && size == sized_font_size) return;
+	if (TTF_SetFontSize(font, size) != 0) {
+		throw image_load_exception(std::string(TTF_GetError()));
+	}
+	sized_font = font;
+	sized_font_size = size;
+}
+
+/**
+ * Decodes the UTF-8 codepoint starting at text[i] and moves i past it. Invalid bytes decode to U+FFFD.
+ */
+static Uint32 next_codepoint(const std::string& text, size_t& i) {
+	const auto byte = [&text](const size_t at) { return static_cast<Uint8>(text[at]); };
+	const Uint8 first = byte(i++);
+	int length;
+	Uint32 codepoint;
+	if (first < 0x80) {
+		return first;
+	} else if ((first & 0xE0) == 0xC0) {
+		length = 1;
+		codepoint = first & 0x1F;
+	} else if ((first & 0xF0) == 0xE0) {
+		length = 2;
+		codepoint = first & 0x0F;
+	} else if ((first & 0xF8) == 0xF0) {
+		length = 3;
+		codepoint = first & 0x07;
+	} else {
+		return 0xFFFD;
+	}
+	for (int k = 0; k < length; ++k) {
+		if (i >= text.size() || (byte(i) & 0xC0) != 0x80) return 0xFFFD;
+		codepoint = (codepoint << 6) | (byte(i++) & 0x3F);
+	}
+	return codepoint;
+}
+
+GlyphAtlas::GlyphAtlas(TTF_Font* const font, const int size) : font(font), size(size) {
+	set_font_size(font, size);
+	line_height = TTF_FontHeight(font);
+	pixels.reset(SDL_CreateRGBSurfaceWithFormat(0, INITIAL_SIZE, INITIAL_SIZE, 32, SDL_PIXELFORMAT_ARGB8888));
+	if (pixels == nullptr) {
+		throw SDL_exception("Could not create glyph atlas surface, " + std::string(SDL_GetError()));
+	}
+	SDL_FillRect(pixels.get(), nullptr, 0);
+	SDL_Texture* const t = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, INITIAL_SIZE, INITIAL_SIZE);
+	if (t == nullptr) {
+		throw SDL_exception("Could not create glyph atlas texture, " + std::string(SDL_GetError()));
+	}
+	SDL_SetTextureBlendMode(t, SDL_BLENDMODE_BLEND);
+	SDL_UpdateTexture(t, nullptr, pixels->pixels, pixels->pitch);
+	texture = Texture(t, INITIAL_SIZE, INITIAL_SIZE);
+}
+
+void GlyphAtlas::grow() {
+	const int w = pixels->w, h = pixels->h * 2;
+	std::unique_ptr<SDL_Surface, SurfaceDeleter> new_pixels(SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888));
+	if (new_pixels == nullptr) {
+		throw SDL_exception("Could not grow glyph atlas, " + std::string(SDL_GetError()));
+	}
+	SDL_FillRect(new_pixels.get(), nullptr, 0);
+	SDL_SetSurfaceBlendMode(pixels.get(), SDL_BLENDMODE_NONE);
+	SDL_BlitSurface(pixels.get(), nullptr, new_pixels.get(), nullptr);
+	SDL_Texture* const t = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, w, h);
+	if (t == nullptr) {
+		throw SDL_exception("Could not grow glyph atlas, " + std::string(SDL_GetError()));
+	}
+	SDL_SetTextureBlendMode(t, SDL_BLENDMODE_BLEND);
+	SDL_UpdateTexture(t, nullptr, new_pixels->pixels, new_pixels->pitch);
+	gRenderQueue.flush();
+	pixels = std::move(new_pixels);
+	texture = Texture(t, w, h);
+}
+
+const Glyph& GlyphAtlas::get_glyph(const Uint32 codepoint) {
+	const auto found = glyphs.find(codepoint);
+	if (found != glyphs.end()) {
+		return found->second;
+	}
+	set_font_size(font, size);
+	int min_x, max_x, min_y, max_y, advance;
+	if (TTF_GlyphMetrics32(font, codepoint, &min_x, &max_x, &min_y, &max_y, &advance) != 0) {
+		throw image_load_exception(std::string(TTF_GetError()));
+	}
+	Glyph glyph = {{0, 0, 0, 0}, std::min(min_x, 0), advance};
+	// Glyphs without pixels, like spaces, fail to render and only advance the pen.
+	std::unique_ptr<SDL_Surface, SurfaceDeleter> surface(TTF_RenderGlyph32_Blended(font, codepoint, {0xFF, 0xFF, 0xFF, 0xFF}));
+	if (surface != nullptr && surface->w > 0 && surface->h > 0) {
+		// One pixel between glyphs keeps filtering from bleeding into neighbours.
+		if (shelf_x + surface->w + 1 > pixels->w) {
+			shelf_x = 0;
+			shelf_y += shelf_height + 1;
+			shelf_height = 0;
+		}
+		while (shelf_y + surface->h > pixels->h) {
+			grow();
+		}
+		glyph.rect = {shelf_x, shelf_y, surface->w, surface->h};
+		SDL_SetSurfaceBlendMode(surface.get(), SDL_BLENDMODE_NONE);
+		SDL_BlitSurface(surface.get(), nullptr, pixels.get(), &glyph.rect);
+		const Uint8* const start = static_cast<const Uint8*>(pixels->pixels) + glyph.rect.y * pixels->pitch + glyph.rect.x * 4;
+		SDL_UpdateTexture(texture.get_texture(), &glyph.rect, start, pixels->pitch);
+		shelf_x += surface->w + 1;
+		shelf_height = std::max(shelf_height, surface->h);
+	}
+	return glyphs.emplace(codepoint, glyph).first->second;
+}
+
+int GlyphAtlas::get_kerning(const Uint32 previous, const Uint32 codepoint) {
+	const Uint64 key = (static_cast<Uint64>(previous) << 32) | codepoint;
+	const auto found = kerning.find(key);
+	if (found != kerning.end()) {
+		return found->second;
+	}
+	set_font_size(font, size);
+	const int k = TTF_GetFontKerningSizeGlyphs32(font, previous, codepoint);
+	kerning.emplace(key, k);
+	return k;
+}
+
+void GlyphAtlas::measure(const std::string& text, int& w, int& h) {
+	int pen = 0, left = 0, right = 0;
+	Uint32 previous = 0;
+	for (size_t i = 0; i < text.size();) {
+		const Uint32 codepoint = next_codepoint(text, i);
+		if (previous != 0) {
+			pen += get_kerning(previous, codepoint);
+		}
+		const Glyph& glyph = get_glyph(codepoint);
+		left = std::min(left, pen + glyph.offset_x);
+		right = std::max(right, std::max(pen + glyph.advance, pen + glyph.offset_x + glyph.rect.w));
+		pen += glyph.advance;
+		previous = codepoint;
+	}
+	w = right - left;
+	h = line_height;
+}
+
+void GlyphAtlas::queue_text(const RenderLayer layer, const std::string& text, const int x, const int y, const SDL_Color color) {
+	int pen = 0, left = 0;
+	Uint32 previous = 0;
+	// First pass finds how far glyphs reach left of the start, which TTF_RenderUTF8_Blended shifts the text by.
+	for (size_t i = 0; i < text.size();) {
+		const Uint32 codepoint = next_codepoint(text, i);
+		if (previous != 0) {
+			pen += get_kerning(previous, codepoint);
+		}
+		const Glyph& glyph = get_glyph(codepoint);
+		left = std::min(left, pen + glyph.offset_x);
+		pen += glyph.advance;
+		previous = codepoint;
+	}
+	pen = -left;
+	previous = 0;
+	for (size_t i = 0; i < text.size();) {
+		const Uint32 codepoint = next_codepoint(text, i);
+		if (previous != 0) {
+			pen += get_kerning(previous, codepoint);
+		}
+		const Glyph& glyph = get_glyph(codepoint);
+		if (glyph.rect.w > 0) {
+			const SDL_Rect dst = {x + pen + glyph.offset_x, y, glyph.rect.w, glyph.rect.h};
+			gRenderQueue.copy(layer, texture, dst, &glyph.rect, color);
+		}
+		pen += glyph.advance;
+		previous = codepoint;
+	}
+}
+
+size_t GlyphAtlas::get_bytes() const {
+	return static_cast<size_t>(texture.get_width()) * texture.get_height() * 4;
+}
+
+/**
+ * Frees the least recently requested atlases only held by the cache until the atlases fit in budget.
+ */
+static void evict_glyph_atlases(const size_t budget) {
+	size_t bytes = 0;
+	for (const auto& [key, cached] : atlases) {
+		bytes += cached.atlas->get_bytes();
+	}
+	while (bytes > budget) {
+		auto oldest = atlases.end();
+		for (auto it = atlases.begin(); it != atlases.end(); ++it) {
+			if (it->second.atlas.use_count() == 1 && (oldest == atlases.end() || it->second.last_request < oldest->second.last_request)) {
+				oldest = it;
+			}
+		}
+		if (oldest == atlases.end()) return;
+		bytes -= oldest->second.atlas->get_bytes();
+		atlases.erase(oldest);
+	}
+}
+
+std::shared_ptr<GlyphAtlas> get_glyph_atlas(TTF_Font* const font, const int size) {
+	const auto found = atlases.find({font, size});
+	if (found != atlases.end()) {
+		found->second.last_request = ++atlas_requests;
+		return found->second.atlas;
+	}
+	std::shared_ptr<GlyphAtlas> atlas = std::make_shared<GlyphAtlas>(font, size);
+	// Evicting before inserting keeps the new atlas from being a candidate.
+	evict_glyph_atlases(atlas_budget > atlas->get_bytes() ? atlas_budget - atlas->get_bytes() : 0);
+	atlases.emplace(std::make_pair(font, size), CachedAtlas{atlas, ++atlas_requests});
+	return atlas;
+}
+
+void set_glyph_atlas_budget(const size_t bytes) {
+	atlas_budget = bytes;
+	evict_glyph_atlases(atlas_budget);
+}
+
+void trim_glyph_atlases() {
+	evict_glyph_atlases(0);
+}
+
+void free_glyph_atlases() {
+	atlases.clear();
+	sized_font = nullptr;
+}
@@ -0,0 +1,111 @@
+#ifndef GLYPH_ATLAS_00_H
+#define GLYPH_ATLAS_00_H
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include "engine.h"
+#include "renderQueue.h"
+#include "texture.h"
+
+/**
+ * A glyph in a GlyphAtlas.
+ */
+struct Glyph {
+	// Area of the atlas holding the glyph, empty for glyphs without pixels.
+	SDL_Rect rect;
+	// Horizontal offset of rect from the pen position.
+	int offset_x;
+	int advance;
+};
+
+/**
+ * White glyphs of one font at one size, rasterized the first time they are used and packed into a single texture,
+ * so that text can be drawn as quads from one texture and coloured through vertex colours.
+ * Uses the renderer, so it may only be used on the main thread.
+ */
+class GlyphAtlas {
+	public:
+		/**
+		 * Creates an empty atlas. Throws SDL_exception if the texture cannot be created.
+		 */
+		GlyphAtlas(TTF_Font* font, int size);
+
+		GlyphAtlas(const GlyphAtlas&) = delete;
+		GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+		/**
+		 * Returns the glyph of codepoint, rasterizing it if it is not in the atlas yet.
+		 * Throws image_load_exception if rasterizing fails.
+		 */
+		const Glyph& get_glyph(Uint32 codepoint);
+
+		/**
+		 * Sets w and h to the size of the UTF-8 text drawn by queue_text.
+		 */
+		void measure(const std::string& text, int& w, int& h);
+
+		/**
+		 * Queues the UTF-8 text with its top left corner at (x, y), kerned like TTF_RenderUTF8_Blended.
+		 */
+		void queue_text(RenderLayer layer, const std::string& text, int x, int y, SDL_Color color);
+
+		/**
+		 * Returns the number of bytes taken by the texture of the atlas.
+		 */
+		[[nodiscard]] size_t get_bytes() const;
+
+	private:
+		static constexpr int INITIAL_SIZE = 256;
+
+		/**
+		 * Doubles the height of the atlas, flushing the render queue first since queued glyphs use the old texture.
+		 */
+		void grow();
+
+		/**
+		 * Returns the kerning between two codepoints at this size.
+		 */
+		int get_kerning(Uint32 previous, Uint32 codepoint);
+
+		TTF_Font* font;
+		int size;
+		int line_height;
+
+		std::unordered_map<Uint32, Glyph> glyphs;
+		// Kerning of codepoint pairs, the first in the upper half. Cached since looking it up needs the font size set.
+		std::unordered_map<Uint64, int> kerning;
+
+		// Copy of the texture, kept to fill the texture again when the atlas grows.
+		std::unique_ptr<SDL_Surface, SurfaceDeleter> pixels;
+		Texture texture;
+
+		// Shelf the next glyph is packed into.
+		int shelf_x = 0, shelf_y = 0, shelf_height = 0;
+};
+
+/**
+ * Returns the atlas of font at size, creating it if needed. Text of one size shares an atlas.
+ * When a new atlas takes the atlases over the budget, the least recently requested ones not held
+ * outside the cache are freed until they fit again.
+ */
+std::shared_ptr<GlyphAtlas> get_glyph_atlas(TTF_Font* font, int size);
+
+/**
+ * Sets the number of texture bytes the atlases may take before those not held outside the cache are freed.
+ */
+void set_glyph_atlas_budget(size_t bytes);
+
+/**
+ * Frees every atlas not held outside the cache.
+ */
+void trim_glyph_atlases();
+
+/**
+ * Empties the cache. Must be called before the renderer is destroyed, after anything holding an atlas is gone.
+ * Game::~Game does this for the renderer it created.
+ */
+void free_glyph_atlases();
+
+#endif
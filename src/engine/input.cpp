@@ -18,57 +18,91 @@ std::string get_input_name(const SDL_Keycode key, const Uint32 mouse) {
 	return "None";
 }
 
-std::unique_ptr<PressInput> get_press_input(const std::string& name, const std::string& default_name) {
-	try {
-		return get_press_input(name);
-	} catch (const binding_exception&) {
-		std::cout << "Invalid key " << name << " using " << default_name << std::endl;
-		return get_press_input(default_name);
+/**
+ * Returns the SDL_BUTTON_*something* value of a mouse input name, or 0 if name is not one.
+ */
+Uint32 get_mouse_button(const std::string& name) {
+	if (name == "Mouse Left") {
+		return SDL_BUTTON_LEFT;
+	} else if (name == "Mouse Middle") {
+		return SDL_BUTTON_MIDDLE;
+	} else if (name == "Mouse Right") {
+		return SDL_BUTTON_RIGHT;
 	}
+	return 0;
 }
 
-std::unique_ptr<HoldInput> get_hold_input(const std::string& name, const std::string& default_name) {
+void ActionMap::bind(const int action, const std::string& name) {
+	if (action < 0 || action >= MAX_ACTIONS) {
+		throw logic_exception("Action id out of range");
+	}
+	if (name == "None") {
+		return;
+	}
+	const Uint32 mouse = get_mouse_button(name);
+	if (mouse != 0) {
+		mouse_actions[mouse].set(action);
+		return;
+	}
+	const SDL_Keycode keycode = SDL_GetKeyFromName(name.c_str());
+	if (keycode == SDLK_UNKNOWN) {
+		throw binding_exception("Invalid key name \"" + name + "\"");
+	}
+	key_actions[keycode].set(action);
+
+	SDL_Scancode scancode = SDL_GetScancodeFromName(name.c_str());
+	if (scancode == SDL_SCANCODE_UNKNOWN) {
+		scancode = SDL_GetScancodeFromKey(keycode);
+	}
+	for (std::pair<SDL_Scancode, ActionSet>& held : held_keys) {
+		if (held.first == scancode) {
+			held.second.set(action);
+			return;
+		}
+	}
+	held_keys.emplace_back(scancode, ActionSet().set(action));
+}
+
+void ActionMap::bind(const int action, const std::string& name, const std::string& default_name) {
 	try {
-		return get_hold_input(name);
+		bind(action, name);
 	} catch (const binding_exception&) {
 		std::cout << "Invalid key \"" << name << "\" using \"" << default_name << '"' << std::endl;
-		return get_hold_input(default_name);
-	}	
+		bind(action, default_name);
+	}
 }
 
-std::unique_ptr<PressInput> get_press_input(const std::string& name) {
-
-	if (name == "Mouse Left") {
-		return std::unique_ptr<PressInput>(new MousePressInput(SDL_BUTTON_LEFT));
-	} else if (name == "Mouse Middle") {
-		return std::unique_ptr<PressInput>(new MousePressInput(SDL_BUTTON_MIDDLE));
-	} else if (name == "Mouse Right") {
-		return std::unique_ptr<PressInput>(new MousePressInput(SDL_BUTTON_RIGHT));
-	} else if (name == "None") {
-		return std::unique_ptr<PressInput>(new EmptyPressInput());
-	}
-	SDL_Keycode keycode = SDL_GetKeyFromName(name.c_str());
-	if (keycode == SDLK_UNKNOWN) {
-		throw binding_exception("Invalid key name \"" + name + "\"");
+void ActionMap::load(const JsonObject& bindings, const ActionBinding* begin, const ActionBinding* end) {
+	for (const ActionBinding* binding = begin; binding != end; ++binding) {
+		bind(binding->action, bindings.get<std::string>(binding->key), "None");
 	}
-	return std::unique_ptr<PressInput>(new KeyPressInput(keycode));	
 }
 
-std::unique_ptr<HoldInput> get_hold_input(const std::string& name) {
+void ActionMap::clear() {
+	mouse_actions.fill(ActionSet());
+	key_actions.clear();
+	held_keys.clear();
+}
 
-	if (name == "Mouse Left") {
-		return std::unique_ptr<HoldInput>(new MouseHoldInput(SDL_BUTTON_LMASK));
-	} else if (name == "Mouse Middle") {
-		return std::unique_ptr<HoldInput>(new MouseHoldInput(SDL_BUTTON_MMASK));
-	} else if (name == "Mouse Right") {
-		return std::unique_ptr<HoldInput>(new MouseHoldInput(SDL_BUTTON_RMASK));
-	} else if (name == "None") {
-		return std::unique_ptr<HoldInput>(new EmptyHoldInput());
+ActionSet ActionMap::get_targeted(const SDL_Keycode key, const Uint32 mouse) const {
+	if (mouse != 0) {
+		return mouse < mouse_actions.size() ? mouse_actions[mouse] : ActionSet();
 	}
-	
-	SDL_Scancode scancode = SDL_GetScancodeFromName(name.c_str());
-	if (scancode == SDL_SCANCODE_UNKNOWN) {
-		throw binding_exception("Invalid key name \"" + name + "\"");
+	const auto it = key_actions.find(key);
+	return it == key_actions.end() ? ActionSet() : it->second;
+}
+
+ActionSet ActionMap::get_held(const Uint8* keys, const Uint32 mouse_mask) const {
+	ActionSet held;
+	for (Uint32 button = SDL_BUTTON_LEFT; button < mouse_actions.size(); ++button) {
+		if ((mouse_mask & SDL_BUTTON(button)) != 0) {
+			held |= mouse_actions[button];
+		}
 	}
-	return std::unique_ptr<HoldInput>(new KeyHoldInput(scancode));
-}
\ No newline at end of file
+	for (const std::pair<SDL_Scancode, ActionSet>& held_key : held_keys) {
+		if (keys[held_key.first]) {
+			held |= held_key.second;
+		}
+	}
+	return held;
+}
@@ -1,10 +1,14 @@
 #ifndef INPUT_00_H
 #define INPUT_00_H
 #include "util/exceptions.h"
-#include <memory>
+#include <array>
+#include <bitset>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 #include <SDL.h>
+#include "file/json.h"
 
 /**
  * Exception type for bad binding names.
@@ -15,163 +19,82 @@ class binding_exception : public base_exception {
 	
 };
 
+// Maximum number of actions in one ActionMap.
+constexpr int MAX_ACTIONS = 32;
+
 /**
- * Class for press inputs, used in event handling methods.
+ * A set of action ids.
  */
-class PressInput {
-	public:
-		/**
-		 * Returns true if this input was the target of a key or mouse event.
-		 */
-		virtual bool is_targeted(SDL_Keycode key, Uint32 mouseButton) = 0;
-
-        virtual ~PressInput() = default;
-};
+using ActionSet = std::bitset<MAX_ACTIONS>;
 
 /**
- * Class for a press input targeted by mouse.
+ * Names an action in a bindings object, see ActionMap::load.
  */
-class MousePressInput : public PressInput {
-	public:
-		explicit MousePressInput(const Uint32 mouse_button) : mouse_button(mouse_button) {}
-		
-		/**
-		 * Returns true if the mouse targets equals the one for this input.
-		 */
-		bool is_targeted(const SDL_Keycode key, const Uint32 mouse) override {
-			return mouse == mouse_button;
-		}
-
-	private:
-		const Uint32 mouse_button;
+struct ActionBinding {
+	int action;
+	const char* key;
 };
 
 /**
- * Class for a press input that can never be triggered.
+ * Maps keys and mouse buttons to the actions bound to them.
+ * Inputs are named as by get_input_name, and "None" binds nothing.
+ * Any number of actions can share an input.
  */
-class EmptyPressInput : public PressInput {
+class ActionMap {
 	public:
 		/**
-		 * Always returns false.
+		 * Binds action to the input named name. Throws a binding_exception if no input matches.
 		 */
-		bool is_targeted(const SDL_Keycode key, const Uint32 mouse) override {
-			return false;
-		}
-};
+		void bind(int action, const std::string& name);
 
-/**
- * Class for a press input triggered by keyboard.
- */
-class KeyPressInput : public PressInput {
-	public:
-		explicit KeyPressInput(const SDL_Keycode key_code) : key_code(key_code) {}
-		
 		/**
-		 * Returns true if the key target equals the one for this input.
+		 * Binds action to the input named name, or to default_name if no input matches.
+		 * If default_name also has no match, a binding_exception is thrown.
 		 */
-		bool is_targeted(const SDL_Keycode key, const Uint32 mouseButton) override {
-			return key_code == key;
-		}
-	
-	private:
-		const SDL_Keycode key_code;
-};
+		void bind(int action, const std::string& name, const std::string& default_name);
 
-/**
- * Class for hold inputs, used when polling an input every frame.
- */
-class HoldInput {
-	public:
 		/**
-		 * Returns true if this input is currently pressed.
+		 * Binds every action in table to the input named by its key in bindings, or to nothing if the name is invalid.
+		 * Throws a json_exception if a key is missing.
 		 */
-		virtual bool is_pressed(const Uint8* keys, Uint32  mouseButton) = 0;
-
-        virtual ~HoldInput() = default;
-};
+		void load(const JsonObject& bindings, const ActionBinding* begin, const ActionBinding* end);
 
-/**
- * Class for hold inputs based on the mouse.
- */
-class MouseHoldInput : public HoldInput {
-	public:
-		explicit MouseHoldInput(const Uint32 mouse_mask) : mouse_mask(mouse_mask) {}
+		template<size_t N>
+		void load(const JsonObject& bindings, const ActionBinding (&table)[N]) {
+			load(bindings, table, table + N);
+		}
 
 		/**
-		 * Returns true if the mouseButton of this input is pressed.
+		 * Removes all bindings.
 		 */
-		bool is_pressed(const Uint8* keys, const Uint32 mouseButton) override {
-			return (mouse_mask & mouseButton) != 0;
-		}
-
-	private:
-		const Uint32 mouse_mask;
-};
-
-/**
- * Class for hold inputs that can never be pressed.
- */
-class EmptyHoldInput : public HoldInput {
-	public:
+		void clear();
 
 		/**
-		 * Always returns false.
-		 */ 
-		bool is_pressed(const Uint8* keys, const Uint32 mouseButton) override {
-			return false;
-		}
-};
-
-/**
- * Class for a hold input targeted by keyboard.
- */
-class KeyHoldInput : public HoldInput {
-	public:
-		explicit KeyHoldInput(const SDL_Scancode key) : key(key) {}
+		 * Returns the actions targeted by a down or up event.
+		 * If mouse contains an SDL_BUTTON_*something* value, the key is ignored.
+		 */
+		[[nodiscard]] ActionSet get_targeted(SDL_Keycode key, Uint32 mouse) const;
 
 		/**
-		 * Returns true if the key matching this input is pressed.
+		 * Returns the actions whose input is currently held, given the keyboard state and mouse button mask.
 		 */
-		bool is_pressed(const Uint8* keys, const Uint32 mouseButton) override {
-			return keys[key];
-		}
+		[[nodiscard]] ActionSet get_held(const Uint8* keys, Uint32 mouse_mask) const;
 
 	private:
-		const SDL_Scancode key;
+		// Indexed by SDL_BUTTON_*.
+		std::array<ActionSet, SDL_BUTTON_X2 + 1> mouse_actions{};
+
+		std::unordered_map<SDL_Keycode, ActionSet> key_actions;
+
+		// Scancodes of bound keys, checked against the keyboard state for held actions.
+		std::vector<std::pair<SDL_Scancode, ActionSet>> held_keys;
 };
 
 /**
  * Returns the name of an input based on a down-event.
  * If mouse contains an SDL_BUTTON_*something* value, the key is ignored.
- * If no name matches, "None" is returned. Passing "None" to get_*hold/press*_input 
- * will return an EmptyHold/Press/Input ptr.
+ * If no name matches, "None" is returned. Binding an action to "None" binds it to nothing.
  */
 std::string get_input_name(SDL_Keycode key, Uint32 mouse);
 
-/**
- * Returns a pointer to a PressInput with the name name.
- * If no input matches, a binding_exception is thrown.
- */
-std::unique_ptr<PressInput> get_press_input(const std::string& name);
-
-/**
- * Returns a pointer to a HoldInput with the name name.
- * If no input matches, a binding_exception is thrown.
- */
-std::unique_ptr<HoldInput> get_hold_input(const std::string& name);
-
-/**
- * Returns a pointer to a PressInput with the name name.
- * If no input matches, default_name is tried instead.
- * If default_name also has no match, a binding_exception is thrown.
- */
-std::unique_ptr<PressInput> get_press_input(const std::string& name, const std::string& default_name);
-
-/**
- * Returns a pointer to a HoldInput with the name name.
- * If no input matches, default_name is tried instead.
- * If default_name also has no match, a binding_exception is thrown.
- */
-std::unique_ptr<HoldInput> get_hold_input(const std::string& name, const std::string& default_name);
-
 #endif
\ No newline at end of file
@@ -0,0 +1,267 @@
+#include "jobs.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <SDL.h>
+#include "profiler.h"
+
+struct Job {
+	std::function<void()> task;
+	engine::TaskGroup* group;
+};
+
+/**
+ * A worker thread and its deque. The owner pushes and pops at the back, thieves take from the front.
+ */
+struct Worker {
+	std::mutex mutex;
+	std::deque<Job> jobs;
+	std::thread thread;
+};
+
+static std::vector<std::unique_ptr<Worker>> workers;
+static std::atomic<bool> jobs_running{false};
+static std::thread::id main_thread;
+
+// Jobs queued by threads that are not workers.
+static std::mutex shared_mutex;
+static std::deque<Job> shared_jobs;
+
+// Idle workers sleep on wake until a job is queued. queued_jobs is only increased while holding wake_mutex.
+static std::mutex wake_mutex;
+static std::condition_variable wake;
+static std::atomic<int> queued_jobs{0};
+static bool stopping = false;
+
+static std::mutex main_tasks_mutex;
+static std::vector<std::function<void()>> main_tasks;
+// Event type pushed by run_on_main_thread, registered by start_jobs. (Uint32)-1 if there is none.
+static Uint32 main_tasks_event = static_cast<Uint32>(-1);
+
+// Index of the calling thread in workers, -1 for other threads.
+static thread_local int worker_index = -1;
+
+static void push_job(Job job) {
+	if (worker_index >= 0) {
+		Worker& worker = *workers[worker_index];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.jobs.push_back(std::move(job));
+	} else {
+		std::lock_guard<std::mutex> lock(shared_mutex);
+		shared_jobs.push_back(std::move(job));
+	}
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		++queued_jobs;
+	}
+	wake.notify_one();
+}
+
+static bool pop_front(std::mutex& mutex, std::deque<Job>& jobs, Job& out) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (jobs.empty()) return false;
+	out = std::move(jobs.front());
+	jobs.pop_front();
+	return true;
+}
+
+/**
+ * Takes the newest job of the calling worker, or the oldest shared job, or steals the oldest job of another worker.
+ */
+static bool take_job(Job& out) {
+	if (queued_jobs.load(std::memory_order_acquire) <= 0) return false;
+	bool found = false;
+	if (worker_index >= 0) {
+		Worker& worker = *workers[worker_index];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (!worker.jobs.empty()) {
+			out = std::move(worker.jobs.back());
+			worker.jobs.pop_back();
+			found = true;
+		}
+	}
+	if (!found) {
+		found = pop_front(shared_mutex, shared_jobs, out);
+	}
+	const size_t count = workers.size();
+	const size_t start = worker_index >= 0 ? static_cast<size_t>(worker_index) + 1 : 0;
+	for (size_t i = 0; !found && i < count; ++i) {
+		Worker& victim = *workers[(start + i) % count];
+		found = pop_front(victim.mutex, victim.jobs, out);
+	}
+	if (found) {
+		--queued_jobs;
+	}
+	return found;
+}
+
+static void execute(Job& job) {
+	PROFILE_ZONE("job");
+	std::exception_ptr error;
+	try {
+		job.task();
+	} catch (...) {
+		error = std::current_exception();
+	}
+	job.group->finish(error);
+}
+
+static void worker_loop(const int index) {
+	worker_index = index;
+	profiler::set_thread_name("worker");
+	while (true) {
+		Job job;
+		if (take_job(job)) {
+			execute(job);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(wake_mutex);
+		if (stopping && queued_jobs.load() <= 0) return;
+		wake.wait(lock, [] { return queued_jobs.load() > 0 || stopping; });
+	}
+}
+
+void engine::start_jobs(unsigned count) {
+	if (jobs_running) return;
+	main_thread = std::this_thread::get_id();
+	if (main_tasks_event == static_cast<Uint32>(-1)) {
+		main_tasks_event = SDL_RegisterEvents(1);
+	}
+	if (count == 0) {
+		count = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+	}
+	if (count == 0) return;
+	stopping = false;
+	// Every worker exists before any starts, since workers steal from each other.
+	for (unsigned i = 0; i < count; ++i) {
+		workers.push_back(std::make_unique<Worker>());
+	}
+	for (unsigned i = 0; i < count; ++i) {
+		workers[i]->thread = std::thread(worker_loop, static_cast<int>(i));
+	}
+	jobs_running = true;
+}
+
+void engine::stop_jobs() {
+	if (!jobs_running) return;
+	// Tasks queued from now on run on the queuing thread.
+	jobs_running = false;
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (const std::unique_ptr<Worker>& worker : workers) {
+		worker->thread.join();
+	}
+	workers.clear();
+}
+
+unsigned engine::worker_count() {
+	return jobs_running ? static_cast<unsigned>(workers.size()) : 0;
+}
+
+void engine::run_on_main_thread(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(main_tasks_mutex);
+		main_tasks.push_back(std::move(task));
+	}
+	// Wakes Game::run if it is waiting for events in an idle state.
+	if (main_tasks_event != static_cast<Uint32>(-1)) {
+		SDL_Event event{};
+		event.type = main_tasks_event;
+		SDL_PushEvent(&event);
+	}
+}
+
+void engine::run_main_thread_tasks() {
+	std::vector<std::function<void()>> tasks;
+	{
+		std::lock_guard<std::mutex> lock(main_tasks_mutex);
+		tasks.swap(main_tasks);
+	}
+	for (std::function<void()>& task : tasks) {
+		task();
+	}
+}
+
+engine::TaskGroup::~TaskGroup() {
+	try {
+		wait();
+	} catch (...) {
+		// The owner did not wait, so nobody is interested in the error.
+	}
+}
+
+void engine::TaskGroup::run(std::function<void()> task) {
+	if (!jobs_running) {
+		std::exception_ptr error;
+		try {
+			task();
+		} catch (...) {
+			error = std::current_exception();
+		}
+		++pending;
+		finish(error);
+		return;
+	}
+	++pending;
+	push_job({std::move(task), this});
+}
+
+void engine::TaskGroup::wait() {
+	const bool on_main_thread = std::this_thread::get_id() == main_thread;
+	while (pending.load(std::memory_order_acquire) > 0) {
+		if (on_main_thread) {
+			run_main_thread_tasks();
+		}
+		Job job;
+		if (take_job(job)) {
+			execute(job);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait_for(lock, std::chrono::milliseconds(1), [this] { return pending.load() == 0; });
+	}
+	// Taking the lock also makes sure the last finish call is done with the group.
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		error = first_error;
+		first_error = nullptr;
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+bool engine::TaskGroup::is_done() const {
+	return pending.load(std::memory_order_acquire) == 0;
+}
+
+void engine::TaskGroup::finish(const std::exception_ptr error) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (error && !first_error) {
+		first_error = error;
+	}
+	if (--pending == 0) {
+		done.notify_all();
+	}
+}
+
+void engine::parallel_for(const int begin, const int end, int grain, const std::function<void(int, int)>& body) {
+	grain = std::max(grain, 1);
+	if (end - begin <= grain || !jobs_running) {
+		if (begin < end) body(begin, end);
+		return;
+	}
+	TaskGroup group;
+	for (int lo = begin; lo < end; lo += grain) {
+		const int hi = std::min(lo + grain, end);
+		group.run([&body, lo, hi] { body(lo, hi); });
+	}
+	group.wait();
+}
@@ -0,0 +1,93 @@
+#ifndef JOBS_00_H
+#define JOBS_00_H
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+
+/*
+ * Shared work-stealing job system. Every worker owns a deque, runs its own tasks newest first
+ * and steals the oldest tasks of the other workers when it runs out.
+ * Tasks never call SDL rendering functions directly, those are handed to run_on_main_thread instead.
+ * When the job system is not running, or has no workers, tasks run immediately on the calling thread.
+ */
+namespace engine {
+
+	/**
+	 * Starts worker threads, by default one less than the number of cores, and registers the event type
+	 * run_on_main_thread pushes. Called by engine::init, after SDL is initialized.
+	 */
+	void start_jobs(unsigned workers = 0);
+
+	/**
+	 * Waits for the workers to finish their queued tasks and stops them. Safe to call more than once.
+	 */
+	void stop_jobs();
+
+	/**
+	 * Returns the number of worker threads, 0 if the job system is not running.
+	 */
+	unsigned worker_count();
+
+	/**
+	 * Queues task to be run on the main thread, the next time run_main_thread_tasks is called.
+	 * Pushes an event, so that a main thread waiting for events in an idle state wakes up.
+	 */
+	void run_on_main_thread(std::function<void()> task);
+
+	/**
+	 * Runs all tasks queued by run_on_main_thread. Called once per frame by Game::run.
+	 */
+	void run_main_thread_tasks();
+
+	/**
+	 * A set of tasks that can be waited on together.
+	 * The first exception thrown by a task is rethrown by wait, the remaining tasks still run.
+	 */
+	class TaskGroup {
+		public:
+			TaskGroup() = default;
+
+			TaskGroup(const TaskGroup&) = delete;
+			TaskGroup& operator=(const TaskGroup&) = delete;
+
+			/**
+			 * Waits for any remaining tasks, ignoring their exceptions.
+			 */
+			~TaskGroup();
+
+			/**
+			 * Queues task as part of this group.
+			 */
+			void run(std::function<void()> task);
+
+			/**
+			 * Runs queued tasks on the calling thread until every task of the group is done.
+			 * On the main thread, tasks queued by run_on_main_thread are run as well, so that a task can wait for one.
+			 */
+			void wait();
+
+			/**
+			 * Returns true if every task of the group is done. wait still has to be called to get their exceptions.
+			 */
+			[[nodiscard]] bool is_done() const;
+
+			// Called by the job system when a task of the group has run.
+			void finish(std::exception_ptr error);
+
+		private:
+			std::atomic<int> pending{0};
+			std::mutex mutex;
+			std::condition_variable done;
+			std::exception_ptr first_error;
+	};
+
+	/**
+	 * Calls body(lo, hi) for consecutive ranges of at most grain indices covering [begin, end), in parallel.
+	 * Returns when every range is done, rethrowing the first exception thrown by body.
+	 */
+	void parallel_for(int begin, int end, int grain, const std::function<void(int, int)>& body);
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include "profiler.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "file/json.h"
+
+// Zones kept per thread, older zones are overwritten.
+constexpr size_t ZONES_PER_THREAD = 1 << 16;
+
+std::atomic<bool> profiler::enabled_flag{false};
+
+struct ZoneRecord {
+	const char* name;
+	Uint64 start;
+	Uint64 end;
+};
+
+/**
+ * Ring buffer of the zones of one thread, made when the thread first records a zone.
+ * Buffers of finished threads are reused by new threads.
+ */
+struct ThreadBuffer {
+	std::vector<ZoneRecord> zones = std::vector<ZoneRecord>(ZONES_PER_THREAD);
+	// Total number of zones recorded, the next zone goes at written % ZONES_PER_THREAD.
+	std::atomic<Uint64> written{0};
+	std::atomic<const char*> name{nullptr};
+	bool in_use = true;
+};
+
+static std::mutex buffers_mutex;
+static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+static Uint64 trace_origin = 0;
+
+/**
+ * Gives the buffer of a thread back when the thread exits.
+ */
+struct ThreadBufferHandle {
+	ThreadBuffer* buffer = nullptr;
+	// Set by set_thread_name, kept here so naming a thread that never records allocates nothing.
+	const char* name = nullptr;
+
+	~ThreadBufferHandle() {
+		if (buffer == nullptr) return;
+		std::lock_guard<std::mutex> lock(buffers_mutex);
+		buffer->in_use = false;
+	}
+};
+
+static thread_local ThreadBufferHandle thread_buffer;
+
+static ThreadBuffer* get_thread_buffer() {
+	if (thread_buffer.buffer != nullptr) return thread_buffer.buffer;
+	std::lock_guard<std::mutex> lock(buffers_mutex);
+	for (const std::unique_ptr<ThreadBuffer>& buffer : buffers) {
+		if (!buffer->in_use) {
+			buffer->in_use = true;
+			buffer->name.store(thread_buffer.name, std::memory_order_relaxed);
+			thread_buffer.buffer = buffer.get();
+			return buffer.get();
+		}
+	}
+	buffers.push_back(std::make_unique<ThreadBuffer>());
+	buffers.back()->name.store(thread_buffer.name, std::memory_order_relaxed);
+	thread_buffer.buffer = buffers.back().get();
+	return thread_buffer.buffer;
+}
+
+void profiler::set_enabled(const bool enabled) {
+	if (enabled && trace_origin == 0) {
+		trace_origin = SDL_GetPerformanceCounter();
+	}
+	enabled_flag.store(enabled, std::memory_order_relaxed);
+}
+
+void profiler::set_thread_name(const char* name) {
+	thread_buffer.name = name;
+	if (thread_buffer.buffer != nullptr) {
+		thread_buffer.buffer->name.store(name, std::memory_order_relaxed);
+	}
+}
+
+void profiler::record(const char* name, const Uint64 start, const Uint64 end) {
+	ThreadBuffer* buffer = get_thread_buffer();
+	const Uint64 index = buffer->written.load(std::memory_order_relaxed);
+	buffer->zones[index % ZONES_PER_THREAD] = {name, start, end};
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+void profiler::write_trace(const std::string& path) {
+	const double to_us = 1e6 / static_cast<double>(SDL_GetPerformanceFrequency());
+	JsonList events;
+	std::lock_guard<std::mutex> lock(buffers_mutex);
+	for (size_t tid = 0; tid < buffers.size(); ++tid) {
+		const ThreadBuffer& buffer = *buffers[tid];
+		const char* thread_name = buffer.name.load(std::memory_order_relaxed);
+		JsonObject meta;
+		meta.set<std::string>("name", "thread_name");
+		meta.set<std::string>("ph", "M");
+		meta.set<int>("pid", 1);
+		meta.set<int>("tid", static_cast<int>(tid));
+		JsonObject args;
+		args.set<std::string>("name", thread_name != nullptr ? thread_name : "thread " + std::to_string(tid));
+		meta.set<JsonObject>("args", std::move(args));
+		events.push_back(std::move(meta));
+
+		const Uint64 written = buffer.written.load(std::memory_order_acquire);
+		const Uint64 first = written > ZONES_PER_THREAD ? written - ZONES_PER_THREAD : 0;
+		for (Uint64 i = first; i < written; ++i) {
+			const ZoneRecord& zone = buffer.zones[i % ZONES_PER_THREAD];
+			JsonObject event;
+			event.reserve(6);
+			event.set<std::string>("name", zone.name);
+			event.set<std::string>("ph", "X");
+			event.set<double>("ts", static_cast<double>(zone.start - trace_origin) * to_us);
+			event.set<double>("dur", static_cast<double>(zone.end - zone.start) * to_us);
+			event.set<int>("pid", 1);
+			event.set<int>("tid", static_cast<int>(tid));
+			events.push_back(std::move(event));
+		}
+	}
+	JsonObject trace;
+	trace.set<JsonList>("traceEvents", std::move(events));
+	trace.set<std::string>("displayTimeUnit", "ms");
+	json::write_to_file(path, trace, false);
+}
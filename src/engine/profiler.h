@@ -0,0 +1,74 @@
+#ifndef PROFILER_00_H
+#define PROFILER_00_H
+#include <atomic>
+#include <string>
+#include <SDL.h>
+
+/*
+ * Scoped CPU profiler. PROFILE_ZONE("name") times the rest of the enclosing scope.
+ * Zones are only recorded while the profiler is enabled, and cost a single relaxed load otherwise.
+ * Building with DISABLE_PROFILER removes them completely.
+ * Every thread records into its own ring buffer holding the most recent zones, without locking.
+ */
+namespace profiler {
+
+	// Use set_enabled and is_enabled instead.
+	extern std::atomic<bool> enabled_flag;
+
+	/**
+	 * Starts or stops recording zones.
+	 */
+	void set_enabled(bool enabled);
+
+	inline bool is_enabled() {
+		return enabled_flag.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Names the calling thread in written traces. name must be a string literal or otherwise outlive the profiler.
+	 * Allocates nothing, the ring buffer of a thread is made when it first records a zone.
+	 */
+	void set_thread_name(const char* name);
+
+	/**
+	 * Records a zone on the calling thread. start and end are performance counter values.
+	 */
+	void record(const char* name, Uint64 start, Uint64 end);
+
+	/**
+	 * Writes the recorded zones of every thread to path in the Chrome Trace Event format,
+	 * which can be opened in chrome://tracing or Perfetto. Zones recorded while writing might be torn,
+	 * so it should be called when other threads are not recording. Throws file_exception if writing fails.
+	 */
+	void write_trace(const std::string& path);
+
+	/**
+	 * Records the time from its construction to its destruction as a zone, if the profiler was enabled when constructed.
+	 */
+	class Zone {
+		public:
+			explicit Zone(const char* name) : name(name), start(is_enabled() ? SDL_GetPerformanceCounter() : 0) {};
+
+			Zone(const Zone&) = delete;
+			Zone& operator=(const Zone&) = delete;
+
+			~Zone() {
+				if (start != 0) record(name, start, SDL_GetPerformanceCounter());
+			}
+
+		private:
+			const char* name;
+			Uint64 start;
+	};
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef DISABLE_PROFILER
+#define PROFILE_ZONE(name)
+#else
+#define PROFILE_ZONE(name) profiler::Zone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#endif
+
+#endif
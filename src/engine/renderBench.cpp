@@ -0,0 +1,86 @@
+#include "renderBench.h"
+#include <cstring>
+#include "frameArena.h"
+#include "renderQueue.h"
+#include "util/stateHash.h"
+
+Uint64 surface_checksum(SDL_Surface* const surface) {
+	if (SDL_MUSTLOCK(surface)) {
+		SDL_LockSurface(surface);
+	}
+	StateHasher hasher;
+	hasher.add(surface->w);
+	hasher.add(surface->h);
+	const size_t row_size = static_cast<size_t>(surface->w) * surface->format->BytesPerPixel;
+	for (int y = 0; y < surface->h; ++y) {
+		const Uint8* const row = static_cast<const Uint8*>(surface->pixels) + static_cast<size_t>(y) * surface->pitch;
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= row_size; i += sizeof(uint64_t)) {
+			uint64_t v;
+			memcpy(&v, row + i, sizeof(v));
+			hasher.add(v);
+		}
+		if (i < row_size) {
+			uint64_t v = 0;
+			memcpy(&v, row + i, row_size - i);
+			hasher.add(v);
+		}
+	}
+	if (SDL_MUSTLOCK(surface)) {
+		SDL_UnlockSurface(surface);
+	}
+	return hasher.get();
+}
+
+RenderBench::RenderBench(const int width, const int height) {
+	window_state.window_width = width;
+	window_state.window_height = height;
+	window_state.screen_width = width;
+	window_state.screen_height = height;
+	window_state.keyboard_state = keys.data();
+}
+
+RenderBenchResult RenderBench::run(State& state, const int frames, SDL_Surface* const framebuffer) {
+	if (const std::unique_ptr<engine::TaskGroup> loading = state.load()) {
+		loading->wait();
+	}
+	state.init(&window_state);
+
+	RenderBenchResult result;
+	StateHasher checksums;
+	const double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+	for (int frame = 0; frame < frames; ++frame) {
+		const Uint64 start = SDL_GetPerformanceCounter();
+		StateStatus status = {StateStatus::NONE, nullptr};
+		state.tick(TICK_DELTA, status);
+		state.publish();
+		const Uint64 tick_end = SDL_GetPerformanceCounter();
+		state.render();
+		gRenderQueue.flush();
+		const Uint64 render_end = SDL_GetPerformanceCounter();
+		state.present();
+		const Uint64 present_end = SDL_GetPerformanceCounter();
+
+		result.stats.record(FramePhase::TICK, static_cast<double>(tick_end - start) / frequency);
+		result.stats.record(FramePhase::RENDER, static_cast<double>(render_end - tick_end) / frequency);
+		result.stats.record(FramePhase::PRESENT, static_cast<double>(present_end - render_end) / frequency);
+		result.stats.record(FramePhase::FRAME, static_cast<double>(present_end - start) / frequency);
+		result.stats.end_frame();
+		gRenderQueue.end_frame();
+		result.commands += gRenderQueue.get_frame_counts().commands;
+		result.draw_calls += gRenderQueue.get_frame_counts().draw_calls;
+		engine::frame_arena().reset();
+
+		// Not timed, so that the checksum does not hide changes in render time.
+		result.final_checksum = surface_checksum(framebuffer);
+		checksums.add(result.final_checksum);
+		++result.frames;
+
+		if (status.action != StateStatus::NONE) {
+			delete status.new_state;
+			break;
+		}
+	}
+	result.checksum = checksums.get();
+	return result;
+}
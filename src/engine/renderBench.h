@@ -0,0 +1,54 @@
+#ifndef RENDER_BENCH_00_H
+#define RENDER_BENCH_00_H
+#include <array>
+#include <SDL.h>
+#include "game.h"
+#include "frameStats.h"
+
+/**
+ * Returns a checksum of the pixels of surface, ignoring the padding at the end of rows.
+ */
+Uint64 surface_checksum(SDL_Surface* surface);
+
+/**
+ * Result of a render bench.
+ */
+struct RenderBenchResult {
+	int frames = 0;
+	// Tick, render and present times of every frame. Event times are left at zero.
+	FrameStats stats;
+	// Checksum of the framebuffer after every frame, combined in order.
+	Uint64 checksum = 0;
+	// Checksum of the framebuffer after the last frame.
+	Uint64 final_checksum = 0;
+	// Totals over all frames, see RenderQueue.
+	long long commands = 0;
+	long long draw_calls = 0;
+};
+
+/**
+ * Drives a state through frames without a window or input, for checking render output and timing on machines without a GPU.
+ * Every frame ticks the state with a fixed delta, renders and presents it like Game::run, and checksums the framebuffer.
+ * The output only depends on the state and the loaded config, so checksums from two builds can be compared.
+ */
+class RenderBench {
+	public:
+		static constexpr double TICK_DELTA = 1.0 / 60.0;
+
+		/**
+		 * Prepares a bench for states rendering to a screen of width by height.
+		 */
+		RenderBench(int width, int height);
+
+		/**
+		 * Loads and initializes state and runs it for frames frames, checksumming framebuffer after each.
+		 * Stops early if the state signals a change of state.
+		 */
+		RenderBenchResult run(State& state, int frames, SDL_Surface* framebuffer);
+
+	private:
+		WindowState window_state{};
+		std::array<Uint8, SDL_NUM_SCANCODES> keys{};
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "renderQueue.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include "engine.h"
+#include "profiler.h"
+
+RenderQueue gRenderQueue;
+
+void RenderQueue::push_quad(
+	const RenderLayer layer, const SDL_BlendMode blend_mode, SDL_Texture* const texture,
+	const SDL_FPoint (&corners)[4], const SDL_FPoint (&tex_coords)[4], const SDL_Color color
+) {
+	commands.push_back({layer, blend_mode, texture, static_cast<int>(commands.size()), static_cast<int>(queued_vertices.size())});
+	for (int i = 0; i < 4; ++i) {
+		queued_vertices.push_back({corners[i], color, tex_coords[i]});
+	}
+	++current.commands;
+}
+
+void RenderQueue::copy(const RenderLayer layer, const Texture& texture, const SDL_Rect& dst, const SDL_Rect* const src, const SDL_Color color) {
+	SDL_Texture* const t = texture.get_texture();
+	if (t == nullptr) return;
+	int texture_w, texture_h;
+	SDL_BlendMode blend_mode;
+	SDL_QueryTexture(t, nullptr, nullptr, &texture_w, &texture_h);
+	SDL_GetTextureBlendMode(t, &blend_mode);
+
+	float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+	if (src != nullptr && texture_w > 0 && texture_h > 0) {
+		u0 = static_cast<float>(src->x) / static_cast<float>(texture_w);
+		v0 = static_cast<float>(src->y) / static_cast<float>(texture_h);
+		u1 = static_cast<float>(src->x + src->w) / static_cast<float>(texture_w);
+		v1 = static_cast<float>(src->y + src->h) / static_cast<float>(texture_h);
+	}
+	const float x0 = static_cast<float>(dst.x), y0 = static_cast<float>(dst.y);
+	const float x1 = static_cast<float>(dst.x + dst.w), y1 = static_cast<float>(dst.y + dst.h);
+	push_quad(layer, blend_mode, t, {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}}, {{u0, v0}, {u1, v0}, {u1, v1}, {u0, v1}}, color);
+}
+
+void RenderQueue::copy(const RenderLayer layer, const Texture& texture, const int x, const int y, const SDL_Color color) {
+	copy(layer, texture, {x, y, texture.get_width(), texture.get_height()}, nullptr, color);
+}
+
+void RenderQueue::fill_rect(const RenderLayer layer, const SDL_Rect& rect, const SDL_Color color, const SDL_BlendMode blend_mode) {
+	const float x0 = static_cast<float>(rect.x), y0 = static_cast<float>(rect.y);
+	const float x1 = static_cast<float>(rect.x + rect.w), y1 = static_cast<float>(rect.y + rect.h);
+	push_quad(layer, blend_mode, nullptr, {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}}, {}, color);
+}
+
+void RenderQueue::polyline(
+	const RenderLayer layer, const std::vector<Vector2D>& points, const double dx, const double dy, const float width, const SDL_Color color
+) {
+	const double half_width = width / 2.0;
+	for (size_t i = 1; i < points.size(); ++i) {
+		const Vector2D a = {points[i - 1].x + dx, points[i - 1].y + dy};
+		const Vector2D b = {points[i].x + dx, points[i].y + dy};
+		const double len = std::hypot(b.x - a.x, b.y - a.y);
+		if (len == 0.0) continue;
+		// Normal of the segment, half the width long.
+		const double nx = -(b.y - a.y) / len * half_width;
+		const double ny = (b.x - a.x) / len * half_width;
+		push_quad(layer, SDL_BLENDMODE_BLEND, nullptr, {
+			{static_cast<float>(a.x + nx), static_cast<float>(a.y + ny)},
+			{static_cast<float>(b.x + nx), static_cast<float>(b.y + ny)},
+			{static_cast<float>(b.x - nx), static_cast<float>(b.y - ny)},
+			{static_cast<float>(a.x - nx), static_cast<float>(a.y - ny)}
+		}, {}, color);
+	}
+}
+
+void RenderQueue::flush() {
+	if (commands.empty()) return;
+	PROFILE_ZONE("RenderQueue::flush");
+	std::sort(commands.begin(), commands.end(), [](const Command& a, const Command& b) {
+		if (a.layer != b.layer) return a.layer < b.layer;
+		if (a.blend_mode != b.blend_mode) return a.blend_mode < b.blend_mode;
+		if (a.texture != b.texture) return std::less<SDL_Texture*>()(a.texture, b.texture);
+		return a.order < b.order;
+	});
+
+	SDL_BlendMode draw_blend_mode;
+	SDL_GetRenderDrawBlendMode(gRenderer, &draw_blend_mode);
+	size_t i = 0;
+	while (i < commands.size()) {
+		// Adjacent commands after sorting can share a draw call even across layers, since nothing is drawn between them.
+		SDL_Texture* const texture = commands[i].texture;
+		const SDL_BlendMode blend_mode = commands[i].blend_mode;
+		batch_vertices.clear();
+		batch_indices.clear();
+		for (; i < commands.size() && commands[i].texture == texture && commands[i].blend_mode == blend_mode; ++i) {
+			const int base = static_cast<int>(batch_vertices.size());
+			batch_vertices.insert(
+				batch_vertices.end(),
+				queued_vertices.begin() + commands[i].first_vertex,
+				queued_vertices.begin() + commands[i].first_vertex + 4
+			);
+			batch_indices.insert(batch_indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+		}
+		if (texture == nullptr) {
+			// Untextured geometry is drawn with the draw blend mode, textured geometry with that of the texture.
+			SDL_SetRenderDrawBlendMode(gRenderer, blend_mode);
+		}
+		SDL_RenderGeometry(
+			gRenderer, texture,
+			batch_vertices.data(), static_cast<int>(batch_vertices.size()),
+			batch_indices.data(), static_cast<int>(batch_indices.size())
+		);
+		++current.draw_calls;
+	}
+	SDL_SetRenderDrawBlendMode(gRenderer, draw_blend_mode);
+	commands.clear();
+	queued_vertices.clear();
+}
+
+void RenderQueue::end_frame() {
+	last_frame = current;
+	current = {};
+}
+
+const RenderCounts& RenderQueue::get_frame_counts() const {
+	return last_frame;
+}
@@ -0,0 +1,98 @@
+#ifndef RENDER_QUEUE_00_H
+#define RENDER_QUEUE_00_H
+#include <vector>
+#include <SDL.h>
+#include "texture.h"
+#include "util/utilities.h"
+
+/**
+ * Layers of the render queue, drawn from first to last.
+ * Within a layer draws are grouped by blend mode and texture, so their order is only kept between draws of one texture.
+ */
+enum class RenderLayer : Uint8 {
+	LEVEL, ENTITIES, PLAYER, ROPE, HOOK, UI, UI_TEXT, TOTAL
+};
+
+/**
+ * Number of commands queued and geometry draw calls made during a frame.
+ */
+struct RenderCounts {
+	int commands = 0;
+	int draw_calls = 0;
+};
+
+/**
+ * Records draw commands during a frame and draws them sorted by layer, blend mode and texture,
+ * merging every run of commands with the same texture and blend mode into a single SDL_RenderGeometry call.
+ * Commands are drawn with the renderer viewport set when flushed.
+ */
+class RenderQueue {
+	public:
+		/**
+		 * Queues the rectangle src of texture (all of it if src is nullptr) to be drawn at dst, modulated by color.
+		 */
+		void copy(RenderLayer layer, const Texture& texture, const SDL_Rect& dst, const SDL_Rect* src = nullptr, SDL_Color color = WHITE);
+
+		/**
+		 * Queues texture to be drawn at (x, y) with its width and height, modulated by color.
+		 */
+		void copy(RenderLayer layer, const Texture& texture, int x, int y, SDL_Color color = WHITE);
+
+		/**
+		 * Queues a filled rectangle, drawn with blend_mode.
+		 */
+		void fill_rect(RenderLayer layer, const SDL_Rect& rect, SDL_Color color, SDL_BlendMode blend_mode = SDL_BLENDMODE_BLEND);
+
+		/**
+		 * Queues lines connecting the points in order, width pixels wide, offset by (dx, dy).
+		 */
+		void polyline(RenderLayer layer, const std::vector<Vector2D>& points, double dx, double dy, float width, SDL_Color color);
+
+		/**
+		 * Draws everything queued so far and clears the queue.
+		 * Anything drawn directly through gRenderer after this is drawn above it.
+		 */
+		void flush();
+
+		/**
+		 * Ends counting the current frame, see get_frame_counts.
+		 */
+		void end_frame();
+
+		/**
+		 * Returns the counts of the last ended frame.
+		 */
+		[[nodiscard]] const RenderCounts& get_frame_counts() const;
+
+	private:
+		static constexpr SDL_Color WHITE = {0xFF, 0xFF, 0xFF, 0xFF};
+
+		/**
+		 * A queued quad. Vertices are stored in order top left, top right, bottom right, bottom left.
+		 */
+		struct Command {
+			RenderLayer layer;
+			SDL_BlendMode blend_mode;
+			SDL_Texture* texture;
+			// Index of the command, keeping the queue order between commands of one texture.
+			int order;
+			int first_vertex;
+		};
+
+		void push_quad(RenderLayer layer, SDL_BlendMode blend_mode, SDL_Texture* texture, const SDL_FPoint (&corners)[4], const SDL_FPoint (&tex_coords)[4], SDL_Color color);
+
+		std::vector<Command> commands;
+		std::vector<SDL_Vertex> queued_vertices;
+
+		// Reused by flush, so that frames do not allocate once they have grown to size.
+		std::vector<SDL_Vertex> batch_vertices;
+		std::vector<int> batch_indices;
+
+		RenderCounts current;
+		RenderCounts last_frame;
+};
+
+// Global render queue, flushed by Game after every render.
+extern RenderQueue gRenderQueue;
+
+#endif
@@ -0,0 +1,241 @@
+#include "replay.h"
+#include <cstdio>
+#include <cstring>
+
+constexpr Uint32 RECORDING_MAGIC = 0x43455247; // "GREC"
+constexpr Uint32 RECORDING_VERSION = 2;
+
+/**
+ * Tags written before every record in a recording.
+ */
+enum class RecordTag : Uint8 {
+	KEY_DOWN = 0,		// i32 keycode.
+	KEY_UP = 1,			// i32 keycode.
+	MOUSE_DOWN = 2,		// u8 button.
+	MOUSE_UP = 3,		// u8 button.
+	WHEEL = 4,			// i32 x, i32 y, float precise x, float precise y, u32 direction.
+	WINDOW = 5,			// i32 mouse x, i32 mouse y, u32 mouse mask, u16 count, then count scancodes (u16) that toggled.
+	TICK = 6			// 8 byte double delta, u64 state hash after the tick.
+};
+
+InputRecorder::InputRecorder(const std::string& path, const WindowState& window_state) :
+	writer(path, true, Codec::LZ) {
+	ok = writer.write(RECORDING_MAGIC) &&
+		writer.write(RECORDING_VERSION) &&
+		writer.write(window_state.screen_width) &&
+		writer.write(window_state.screen_height);
+	record_window(window_state);
+}
+
+void InputRecorder::record_event(const SDL_Event& e) {
+	if (!ok) return;
+	switch (e.type) {
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+			ok = writer.write(e.type == SDL_KEYDOWN ? RecordTag::KEY_DOWN : RecordTag::KEY_UP) &&
+				writer.write(static_cast<Sint32>(e.key.keysym.sym));
+			break;
+		case SDL_MOUSEBUTTONDOWN:
+		case SDL_MOUSEBUTTONUP:
+			ok = writer.write(e.type == SDL_MOUSEBUTTONDOWN ? RecordTag::MOUSE_DOWN : RecordTag::MOUSE_UP) &&
+				writer.write(e.button.button);
+			break;
+		case SDL_MOUSEWHEEL:
+			ok = writer.write(RecordTag::WHEEL) &&
+				writer.write(e.wheel.x) &&
+				writer.write(e.wheel.y) &&
+				writer.write(e.wheel.preciseX) &&
+				writer.write(e.wheel.preciseY) &&
+				writer.write(e.wheel.direction);
+			break;
+	}
+}
+
+void InputRecorder::record_window(const WindowState& window_state) {
+	if (!ok) return;
+	Uint16 changed[SDL_NUM_SCANCODES];
+	Uint16 count = 0;
+	if (window_state.keyboard_state != nullptr) {
+		for (int i = 0; i < SDL_NUM_SCANCODES; ++i) {
+			if ((window_state.keyboard_state[i] != 0) != (keys[i] != 0)) {
+				changed[count++] = static_cast<Uint16>(i);
+				keys[i] = window_state.keyboard_state[i] != 0;
+			}
+		}
+	}
+	if (count == 0 && window_state.mouseX == mouse_x && window_state.mouseY == mouse_y && window_state.mouse_mask == mouse_mask) {
+		return;
+	}
+	mouse_x = window_state.mouseX;
+	mouse_y = window_state.mouseY;
+	mouse_mask = window_state.mouse_mask;
+	ok = writer.write(RecordTag::WINDOW) &&
+		writer.write(mouse_x) &&
+		writer.write(mouse_y) &&
+		writer.write(mouse_mask) &&
+		writer.write(count) &&
+		writer.write_many(changed, count);
+}
+
+void InputRecorder::record_tick(const double delta, const Uint64 hash) {
+	if (!ok) return;
+	ok = writer.write(RecordTag::TICK) && writer.write(delta) && writer.write(hash);
+}
+
+bool InputRecorder::flush() {
+	ok = ok && writer.flush();
+	return ok;
+}
+
+Replay::Replay(const std::string& path) : reader(path, true, true) {
+	Uint32 magic = 0, version = 0;
+	if (
+		!reader.read_next(magic) || magic != RECORDING_MAGIC ||
+		!reader.read_next(version) || version != RECORDING_VERSION ||
+		!reader.read_next(window_state.screen_width) ||
+		!reader.read_next(window_state.screen_height)
+	) {
+		throw file_exception("Invalid recording \"" + path + "\"");
+	}
+	window_state.window_width = window_state.screen_width;
+	window_state.window_height = window_state.screen_height;
+	window_state.keyboard_state = keys.data();
+}
+
+int Replay::get_screen_width() const {
+	return window_state.screen_width;
+}
+
+int Replay::get_screen_height() const {
+	return window_state.screen_height;
+}
+
+/**
+ * Reads the next field of a record into t. Throws file_exception if the record is truncated.
+ */
+template<class T>
+static void read_record(FileReader& reader, T& t) {
+	if (!reader.read_next(t)) {
+		throw file_exception("Truncated recording");
+	}
+}
+
+ReplayResult Replay::run(State& state, FileWriter* const hashes) {
+	if (const std::unique_ptr<engine::TaskGroup> loading = state.load()) {
+		loading->wait();
+	}
+	state.init(&window_state);
+
+	ReplayResult result;
+	const double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+	const Uint64 start = SDL_GetPerformanceCounter();
+	RecordTag tag;
+	while (reader.read_next(tag)) {
+		switch (tag) {
+			case RecordTag::KEY_DOWN:
+			case RecordTag::KEY_UP: {
+				Sint32 key;
+				read_record(reader, key);
+				if (tag == RecordTag::KEY_DOWN) {
+					state.handle_down(static_cast<SDL_Keycode>(key), 0);
+				} else {
+					state.handle_up(static_cast<SDL_Keycode>(key), 0);
+				}
+				break;
+			}
+			case RecordTag::MOUSE_DOWN:
+			case RecordTag::MOUSE_UP: {
+				Uint8 button;
+				read_record(reader, button);
+				if (tag == RecordTag::MOUSE_DOWN) {
+					state.handle_down(SDLK_UNKNOWN, button);
+				} else {
+					state.handle_up(SDLK_UNKNOWN, button);
+				}
+				break;
+			}
+			case RecordTag::WHEEL: {
+				SDL_MouseWheelEvent e{};
+				e.type = SDL_MOUSEWHEEL;
+				read_record(reader, e.x);
+				read_record(reader, e.y);
+				read_record(reader, e.preciseX);
+				read_record(reader, e.preciseY);
+				read_record(reader, e.direction);
+				state.handle_wheel(e);
+				break;
+			}
+			case RecordTag::WINDOW: {
+				Uint16 count;
+				read_record(reader, window_state.mouseX);
+				read_record(reader, window_state.mouseY);
+				read_record(reader, window_state.mouse_mask);
+				read_record(reader, count);
+				for (Uint16 i = 0; i < count; ++i) {
+					Uint16 scancode;
+					read_record(reader, scancode);
+					if (scancode >= SDL_NUM_SCANCODES) {
+						throw file_exception("Invalid scancode in recording");
+					}
+					keys[scancode] = !keys[scancode];
+				}
+				break;
+			}
+			case RecordTag::TICK: {
+				double delta;
+				Uint64 recorded_hash;
+				read_record(reader, delta);
+				read_record(reader, recorded_hash);
+				StateStatus status = {StateStatus::NONE, nullptr};
+				state.tick(delta, status);
+				state.publish();
+				++result.ticks;
+				result.simulated_time += delta;
+				result.final_hash = state.hash_state();
+				if (result.final_hash != recorded_hash && result.first_divergent_tick == 0) {
+					result.first_divergent_tick = result.ticks;
+				}
+				if (hashes != nullptr) {
+					char line[32];
+					std::snprintf(line, sizeof(line), "%d %016llx\n", result.ticks, static_cast<unsigned long long>(result.final_hash));
+					hashes->write(std::string(line));
+				}
+				if (status.action != StateStatus::NONE) {
+					delete status.new_state;
+					// Recordings end with the tick that changed state.
+					result.completed = !reader.read_next(tag);
+					result.elapsed_time = static_cast<double>(SDL_GetPerformanceCounter() - start) / frequency;
+					return result;
+				}
+				break;
+			}
+			default:
+				throw file_exception("Invalid record in recording");
+		}
+	}
+	result.elapsed_time = static_cast<double>(SDL_GetPerformanceCounter() - start) / frequency;
+	return result;
+}
+
+HeadlessRenderer::HeadlessRenderer(const int width, const int height) {
+	if (gRenderer != nullptr) {
+		throw logic_exception("A renderer already exists");
+	}
+	surface.reset(SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888));
+	if (surface == nullptr) {
+		throw SDL_exception("Could not create surface, " + std::string(SDL_GetError()));
+	}
+	gRenderer = SDL_CreateSoftwareRenderer(surface.get());
+	if (gRenderer == nullptr) {
+		throw SDL_exception("Could not create software renderer, " + std::string(SDL_GetError()));
+	}
+}
+
+HeadlessRenderer::~HeadlessRenderer() {
+	SDL_DestroyRenderer(gRenderer);
+	gRenderer = nullptr;
+}
+
+SDL_Surface* HeadlessRenderer::get_surface() const {
+	return surface.get();
+}
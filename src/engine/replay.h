@@ -0,0 +1,127 @@
+#ifndef REPLAY_00_H
+#define REPLAY_00_H
+#include <array>
+#include <memory>
+#include <string>
+#include <SDL.h>
+#include "game.h"
+#include "file/fileIO.h"
+
+/*
+ * Recording of the input a state is ticked with, and headless replay of such recordings.
+ * A recording starts with the screen size the state was initialized with, followed by a record for
+ * every dispatched event, every change of the mouse and keyboard state, and every tick with its delta
+ * and the State::hash_state after it. Replaying gives the same ticks as long as the state only depends
+ * on its input and the loaded config, and the recorded hashes show where it does not.
+ */
+
+/**
+ * Writes a recording to a compressed file.
+ */
+class InputRecorder {
+	public:
+		/**
+		 * Starts a recording of a state initialized with window_state. Throws file_exception if path cannot be opened.
+		 */
+		InputRecorder(const std::string& path, const WindowState& window_state);
+
+		/**
+		 * Records an event dispatched to the state. Events other than key, mouse button and wheel events are ignored.
+		 */
+		void record_event(const SDL_Event& e);
+
+		/**
+		 * Records the mouse and keyboard state the state sees, if it changed since it was last recorded.
+		 */
+		void record_window(const WindowState& window_state);
+
+		/**
+		 * Records a tick of delta seconds, after which the state hashed to hash.
+		 */
+		void record_tick(double delta, Uint64 hash);
+
+		/**
+		 * Writes everything recorded so far. Returns false if any write failed.
+		 */
+		bool flush();
+
+	private:
+		FileWriter writer;
+		bool ok = true;
+
+		int mouse_x = 0, mouse_y = 0;
+		Uint32 mouse_mask = 0;
+		std::array<Uint8, SDL_NUM_SCANCODES> keys{};
+};
+
+/**
+ * Time taken by a replay.
+ */
+struct ReplayResult {
+	int ticks = 0;
+	// Sum of the recorded deltas, in seconds.
+	double simulated_time = 0.0;
+	// Time spent replaying, in seconds.
+	double elapsed_time = 0.0;
+	// False if the state signaled a change of state before the last tick of the recording.
+	bool completed = true;
+	// First tick (counting from 1) after which the state hash differed from the recorded one, 0 if none did.
+	int first_divergent_tick = 0;
+	// State hash after the last tick.
+	Uint64 final_hash = 0;
+};
+
+/**
+ * Reads a recording and feeds it into a state.
+ */
+class Replay {
+	public:
+		/**
+		 * Opens the recording at path. Throws file_exception if it cannot be read or is not a recording.
+		 */
+		explicit Replay(const std::string& path);
+
+		/**
+		 * Initializes state and ticks it through the whole recording as fast as possible, without rendering.
+		 * Stops early if the state signals a change of state. Throws file_exception if the recording is corrupt.
+		 * If hashes is given, a line with the tick number and state hash is written to it after every tick,
+		 * so that replays from two builds can be diffed.
+		 */
+		ReplayResult run(State& state, FileWriter* hashes = nullptr);
+
+		[[nodiscard]] int get_screen_width() const;
+
+		[[nodiscard]] int get_screen_height() const;
+
+	private:
+		FileReader reader;
+		WindowState window_state{};
+		std::array<Uint8, SDL_NUM_SCANCODES> keys{};
+};
+
+/**
+ * Points gRenderer to a software renderer drawing into a surface while alive, for running states without a window.
+ * Anything created with the renderer has to be freed before it is destroyed.
+ */
+class HeadlessRenderer {
+	public:
+		/**
+		 * Throws SDL_exception if creating the renderer fails, or logic_exception if gRenderer is already set.
+		 */
+		HeadlessRenderer(int width, int height);
+
+		HeadlessRenderer(const HeadlessRenderer&) = delete;
+		HeadlessRenderer& operator=(const HeadlessRenderer&) = delete;
+
+		~HeadlessRenderer();
+
+		/**
+		 * Returns the surface rendered to.
+		 */
+		[[nodiscard]] SDL_Surface* get_surface() const;
+
+	private:
+		std::unique_ptr<SDL_Surface, SurfaceDeleter> surface;
+};
+
+#endif
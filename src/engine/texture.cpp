@@ -2,6 +2,14 @@
 #include "texture.h"
 #include "engine.h"
 
+std::unique_ptr<SDL_Surface, SurfaceDeleter> load_surface(const std::string& path) {
+	std::unique_ptr<SDL_Surface, SurfaceDeleter> surface(IMG_Load(path.c_str()));
+	if (surface == nullptr) {
+		throw image_load_exception(std::string(IMG_GetError()));
+	}
+	return surface;
+}
+
 void Texture::load_from_file(const std::string& path) {
 	free();
 	
@@ -70,6 +78,10 @@ int Texture::get_width() const {
 	return width;
 }
 
+SDL_Texture* Texture::get_texture() const {
+	return texture;
+}
+
 void Texture::set_dimensions(const int w, const int h) {
 	this->width = w;
 	this->height = h;
@@ -3,7 +3,15 @@
 
 #include <SDL.h>
 #include <SDL_image.h>
+#include <memory>
 #include <string>
+#include "engine.h"
+
+/**
+ * Loads the image at path into a surface, throwing an image_load_exception if something goes wrong.
+ * Unlike textures, surfaces can be loaded off the main thread.
+ */
+std::unique_ptr<SDL_Surface, SurfaceDeleter> load_surface(const std::string& path);
 
 /**
  * Wrapper class for an SDL_Texture, also containing width and height.
@@ -68,6 +76,11 @@ class Texture {
 		 */
 		void set_dimensions(int w, int h);
 		
+		/**
+		 * Returns the underlying SDL_Texture, which is still owned by this texture.
+		 */
+		[[nodiscard]] SDL_Texture* get_texture() const;
+
 		/** 
 		 * Sets the color modulation.
 		 */
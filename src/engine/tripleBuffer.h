@@ -0,0 +1,48 @@
+#ifndef TRIPLE_BUFFER_00_H
+#define TRIPLE_BUFFER_00_H
+#include <atomic>
+
+/**
+ * Hands values from one writer thread to one reader thread without locking.
+ * The writer fills write_buffer and calls publish, the reader calls read to get the newest published value.
+ * Neither side ever waits for the other, and a value being read is never written to.
+ */
+template<class T>
+class TripleBuffer {
+	public:
+		/**
+		 * Returns the buffer to build the next value in. Only used by the writer.
+		 */
+		T& write_buffer() {
+			return buffers[back];
+		}
+
+		/**
+		 * Makes the write buffer the newest value, and hands the writer a free buffer.
+		 */
+		void publish() {
+			back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+		}
+
+		/**
+		 * Returns the newest published value. Only used by the reader, and valid until its next call to read.
+		 */
+		const T& read() {
+			if (middle.load(std::memory_order_relaxed) & FRESH) {
+				front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+			}
+			return buffers[front];
+		}
+
+	private:
+		static constexpr unsigned FRESH = 4;
+		static constexpr unsigned INDEX_MASK = 3;
+
+		T buffers[3];
+		unsigned back = 0;
+		// Index of the buffer between writer and reader, with FRESH set if it has not been read.
+		std::atomic<unsigned> middle{1};
+		unsigned front = 2;
+};
+
+#endif
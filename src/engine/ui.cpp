@@ -1,4 +1,5 @@
 #include "ui.h"
+#include "renderQueue.h"
 
 #include <utility>
 
@@ -14,28 +15,17 @@ void TextBox::init(SDL_RWops* font_data) {
 TextBox::TextBox(const int x, const int y, const int w, const int h, const std::string& text) : TextBox(x, y, w, h, text, 20) {}
 
 TextBox::TextBox(
-	const int x, const int y, const int w, const int h, std::string  text, const int font_size) : x(x), y(y), w(w), h(h), text(std::move(text)), font_size(font_size), texture(nullptr, 0, 0) {
-	generate_texture();
+	const int x, const int y, const int w, const int h, std::string  text, const int font_size) : x(x), y(y), w(w), h(h), text(std::move(text)), font_size(font_size) {
+	layout();
 }
 
 
-void TextBox::generate_texture() {
-	TTF_SetFontSize(font, font_size);
-	SDL_Surface* text_surface = TTF_RenderUTF8_Blended(font, text.c_str(), color);
-	if (text_surface == nullptr) {
-		throw image_load_exception(std::string(TTF_GetError()));
+void TextBox::layout() {
+	if (atlas == nullptr) {
+		atlas = get_glyph_atlas(font, font_size);
 	}
-	int width = text_surface->w;
-	int height = text_surface->h;
-	SDL_Texture* text_texture = SDL_CreateTextureFromSurface(gRenderer, text_surface);
-	SDL_FreeSurface(text_surface);
-
-	if (text_texture == nullptr) {
-		throw image_load_exception(std::string(SDL_GetError()));
-	}
-	texture = Texture(text_texture, width, height);
-
-	TTF_SizeUTF8(font, text.c_str(), &width, &height);
+	int width, height;
+	atlas->measure(text, width, height);
 	text_offset_x = (w - width) / 2;
 	text_offset_y = (h - height) / 2;
 }
@@ -46,13 +36,13 @@ void TextBox::set_position(const int new_x, const int new_y) {
 }
 
 void TextBox::set_text(const std::string& new_text) {
+	if (new_text == text) return;
 	text = new_text;
-	generate_texture();
+	layout();
 }
 
 void TextBox::set_text_color(const Uint8 r, const Uint8 g, const Uint8 b, const Uint8 a) {
 	color = {r, g, b, a};
-	generate_texture();
 }
 
 const SDL_Color& TextBox::get_text_color() const {
@@ -61,7 +51,8 @@ const SDL_Color& TextBox::get_text_color() const {
 
 void TextBox::set_font_size(const int new_font_size) {
 	font_size = new_font_size;
-	generate_texture();
+	atlas = get_glyph_atlas(font, font_size);
+	layout();
 }
 
 const std::string& TextBox::get_text() {
@@ -77,7 +68,10 @@ void TextBox::set_dimensions(const int new_w, const int new_h) {
 }
 
 void TextBox::render(const int x_offset, const int y_offset) {
-	texture.render(x_offset + x + text_offset_x, y_offset + y + text_offset_y);
+	if (text.empty()) return;
+	// Like TTF_RenderUTF8_Blended, a fully transparent colour is drawn opaque.
+	const SDL_Color c = {color.r, color.g, color.b, color.a == 0 ? static_cast<Uint8>(0xFF) : color.a};
+	atlas->queue_text(RenderLayer::UI_TEXT, text, x_offset + x + text_offset_x, y_offset + y + text_offset_y, c);
 }
 
 bool Button::is_pressed(const int mouseX, const int mouseY) const {
@@ -91,20 +85,11 @@ void Button::set_hover(const bool new_hover) {
 void Button::render(const int x_offset, const int y_offset) {
 	SDL_Rect r = {x + x_offset, y + y_offset, w, h};
 	if (background != nullptr) {
-		if (hover) {
-			background->set_color_mod(200, 200, 200);
-		} else {
-			background->set_color_mod(255, 255, 255);
-		}
-		background->set_dimensions(r.w, r.h);
-		background->render(r.x, r.y);
+		const SDL_Color color = hover ? SDL_Color{200, 200, 200, 0xFF} : SDL_Color{255, 255, 255, 0xFF};
+		gRenderQueue.copy(RenderLayer::UI, *background, r, nullptr, color);
 	} else {
-		if (hover) {
-			SDL_SetRenderDrawColor(gRenderer, 200, 200, 240, 0xFF);
-		} else {
-			SDL_SetRenderDrawColor(gRenderer, 100, 100, 220, 0xFF);
-		}
-		SDL_RenderFillRect(gRenderer, &r);
+		const SDL_Color color = hover ? SDL_Color{200, 200, 240, 0xFF} : SDL_Color{100, 100, 220, 0xFF};
+		gRenderQueue.fill_rect(RenderLayer::UI, r, color);
 	}
 	
 	
@@ -112,12 +97,11 @@ void Button::render(const int x_offset, const int y_offset) {
 }
 
 Menu::Menu() : State() {
-	// Since get_press_input can throw exceptions...
-	exit_input = std::unique_ptr<PressInput>(new KeyPressInput(SDLK_ESCAPE));
+	actions.bind(EXIT, "Escape");
 }
 
 Menu::Menu(const std::string& exit_input) : State() {
-	this->exit_input = get_press_input(exit_input, "Escape");
+	actions.bind(EXIT, exit_input, "Escape");
 }
 
 void Menu::handle_down(const SDL_Keycode key, const Uint8 mouse) {
@@ -130,7 +114,7 @@ void Menu::handle_down(const SDL_Keycode key, const Uint8 mouse) {
 			}
 		}
 	}
-	if (exit_input->is_targeted(key, mouse)) {
+	if (actions.get_targeted(key, mouse)[EXIT]) {
 		menu_exit();
 	}
 }
@@ -154,15 +138,18 @@ void Menu::render() {
 	for (auto& t : text) {
 		t.render(0, 0);
 	}
-	SDL_RenderPresent(gRenderer);
 }
 
-void Menu::tick(const Uint64 delta, StateStatus& res) {
+void Menu::tick(const double delta, StateStatus& res) {
 	res = next_res;
 	next_res.action = StateStatus::NONE;
 	next_res.new_state = nullptr;
 }
 
+bool Menu::is_idle() const {
+	return true;
+}
+
 void Menu::menu_exit() {
 	next_res.action = StateStatus::POP;
 }
\ No newline at end of file
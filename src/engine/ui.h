@@ -2,11 +2,14 @@
 #define UI_00_H
 #include <SDL.h>
 #include <SDL_ttf.h>
+#include <algorithm>
+#include <functional>
 #include <vector>
 #include <string>
 #include <memory>
 #include "util/exceptions.h"
 #include "game.h"
+#include "glyphAtlas.h"
 #include "input.h"
 
 class TextBox {
@@ -75,14 +78,15 @@ class TextBox {
 		std::string text;
 
 	private:
-		Texture texture;
-		
 		SDL_Color color = {0, 0, 0, 0};
 
+		// Atlas of font_size, shared by every textbox using that size.
+		std::shared_ptr<GlyphAtlas> atlas;
+
 		/**
-		 * Generates the texture containing the text of the button. Called by constuctor and set_text.
+		 * Centers the text in the textbox. Called by constructor, set_text and set_font_size.
 		 */
-		void generate_texture();
+		void layout();
 
 		static TTF_Font* font;
 };
@@ -123,6 +127,139 @@ class Button : public TextBox {
 		std::shared_ptr<Texture> background;
 };
 
+/**
+ * Vertically scrolling list of count entries of equal height, of which only the rows inside the viewport exist.
+ * Rows are copied from a laid out prototype once for the height of the viewport and recycled while scrolling:
+ * bind is called to update a row, for example through set_text, when it starts showing another entry,
+ * so an entry outside the viewport costs nothing.
+ * Row needs render(x_offset, y_offset), and is drawn relative to the top left of its entry.
+ */
+template<class Row>
+class VirtualList {
+	public:
+		using Bind = std::function<void(int index, Row& row)>;
+
+		VirtualList() = default;
+
+		VirtualList(const SDL_Rect& viewport, const int row_height, const Row& prototype, Bind bind) :
+			viewport(viewport), row_height(row_height), bind(std::move(bind)),
+			// One more than fits, as a scrolled viewport shows part of a row at both edges.
+			slots((viewport.h + row_height - 1) / row_height + 1, Slot{-1, prototype}) {};
+
+		/**
+		 * Sets the number of entries, rebinding every row.
+		 */
+		void set_count(const int new_count) {
+			count = new_count;
+			scroll_to(scroll);
+			invalidate();
+		}
+
+		[[nodiscard]] int get_count() const {
+			return count;
+		}
+
+		/**
+		 * Scrolls to y pixels below the top of the first entry, clamped so the viewport stays filled.
+		 */
+		void scroll_to(const int y) {
+			scroll = std::max(0, std::min(y, count * row_height - viewport.h));
+		}
+
+		void scroll_by(const int dy) {
+			scroll_to(scroll + dy);
+		}
+
+		[[nodiscard]] int get_scroll() const {
+			return scroll;
+		}
+
+		/**
+		 * Rebinds every row the next time it is used, for when the entries change.
+		 */
+		void invalidate() {
+			for (Slot& slot : slots) {
+				slot.index = -1;
+			}
+		}
+
+		/**
+		 * Rebinds the row showing entry index, if any, the next time it is used.
+		 */
+		void invalidate(const int index) {
+			if (index < 0 || slots.empty()) return;
+			Slot& slot = slots[index % slots.size()];
+			if (slot.index == index) {
+				slot.index = -1;
+			}
+		}
+
+		/**
+		 * Returns the entry at the screen point (x, y), or -1 if there is none.
+		 */
+		[[nodiscard]] int index_at(const int x, const int y) const {
+			if (x < viewport.x || x >= viewport.x + viewport.w || y < viewport.y || y >= viewport.y + viewport.h) {
+				return -1;
+			}
+			const int index = (y - viewport.y + scroll) / row_height;
+			return index < count ? index : -1;
+		}
+
+		/**
+		 * Returns the screen position of the top left of entry index.
+		 */
+		[[nodiscard]] SDL_Point get_origin(const int index) const {
+			return {viewport.x, viewport.y + index * row_height - scroll};
+		}
+
+		/**
+		 * Calls f(index, row, origin) for every entry inside the viewport, binding rows first where needed.
+		 */
+		template<class F>
+		void for_each_visible(F f) {
+			if (slots.empty()) return;
+			const int first = scroll / row_height;
+			const int last = std::min(count, (scroll + viewport.h + row_height - 1) / row_height);
+			for (int i = first; i < last; ++i) {
+				Slot& slot = slots[i % slots.size()];
+				if (slot.index != i) {
+					bind(i, slot.row);
+					slot.index = i;
+				}
+				f(i, slot.row, get_origin(i));
+			}
+		}
+
+		/**
+		 * Renders the rows inside the viewport, clipping the rows at the edges to it.
+		 * Flushes gRenderQueue before and after, so the clip only applies to the rows.
+		 */
+		void render() {
+			gRenderQueue.flush();
+			SDL_RenderSetClipRect(gRenderer, &viewport);
+			for_each_visible([](int, Row& row, const SDL_Point& origin) {
+				row.render(origin.x, origin.y);
+			});
+			gRenderQueue.flush();
+			SDL_RenderSetClipRect(gRenderer, nullptr);
+		}
+
+	private:
+		struct Slot {
+			// Entry shown by the row, -1 if it needs binding.
+			int index = -1;
+			Row row;
+		};
+
+		SDL_Rect viewport{};
+		int row_height = 1;
+		int count = 0;
+		int scroll = 0;
+		Bind bind;
+		// Entry i is shown by slots[i % slots.size()], which is never shared by two visible entries.
+		std::vector<Slot> slots;
+};
+
 class Menu : public State {
 	public:	
 		Menu();
@@ -147,7 +284,12 @@ class Menu : public State {
 		/**
 		 * Ticks the menu, deciding if to switch state.
 		 */
-		void tick(Uint64 delta, StateStatus& res) override;
+		void tick(double delta, StateStatus& res) override;
+
+		/**
+		 * Returns true, menus only change on input.
+		 */
+		[[nodiscard]] bool is_idle() const override;
 
 	protected:
 		std::vector<Button> buttons;
@@ -170,9 +312,13 @@ class Menu : public State {
 		virtual void menu_exit();
 
 	private:
+		enum Action {
+			EXIT
+		};
+
 		int targeted_button = 0;
 
-		std::unique_ptr<PressInput> exit_input;
+		ActionMap actions;
 };
 
 #endif
\ No newline at end of file
@@ -2,45 +2,148 @@
 #define ZLIB_CONST
 #include <zlib.h>
 #include <climits>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include "compression.h"
 
 #define BUFFER_SIZE 65536
 
+constexpr Uint8 HEADER_MAGIC = 0xA0;
+
+// Uncompressed size of one LZ block. Blocks are independent, so offsets always fit in 16 bits.
+constexpr unsigned LZ_BLOCK_SIZE = 32768;
+constexpr unsigned LZ_MIN_MATCH = 4;
+constexpr unsigned LZ_HASH_BITS = 12;
+// Set in the compressed size of a block header if the block is stored uncompressed.
+constexpr Uint32 LZ_RAW_FLAG = 0x80000000;
+constexpr unsigned LZ_BLOCK_HEADER = 8;
+// Bytes the decoder may write past the end of a block, or read past the end of the input.
+constexpr unsigned LZ_COPY_SLACK = 16;
+
+// Worst case of an LZ block is all literals, which needs one extra byte per 255 literals.
+static_assert(LZ_BLOCK_SIZE + LZ_BLOCK_SIZE / 255 + 32 <= BUFFER_SIZE, "LZ block does not fit in buffer");
+
+struct CompressData;
+
+/**
+ * Functions implementing a codec. read and write return the number of bytes read or consumed,
+ * finish is called when closing a stream that has been written to.
+ */
+struct CodecOps {
+	bool (*init)(CompressData*, bool def, int level);
+	unsigned (*read)(CompressData*, unsigned char* dest, unsigned len);
+	unsigned (*write)(CompressData*, const unsigned char* data, unsigned len);
+	void (*finish)(CompressData*);
+	void (*end)(CompressData*);
+};
+
 struct CompressData {
+	SDL_RWops* source;
+	const CodecOps* ops;
+	bool def;
+
 	z_stream stream;
 	unsigned char buffer[BUFFER_SIZE];
 	unsigned buffer_pos;
 	int(*data_filter) (z_stream*, int);
 	int(*end_filter) (z_stream*);
+
+	// Uncompressed LZ block and read / write position in it.
+	std::unique_ptr<unsigned char[]> block;
+	std::unique_ptr<Uint32[]> hash_table;
+	unsigned block_len;
+	unsigned block_pos;
 };
 
-Sint64 compressSize(SDL_RWops*) {
-	return -1;
+/**
+ * Reads exactly len bytes from source, returning false if not all could be read.
+ */
+static bool read_fully(SDL_RWops* source, unsigned char* dest, const size_t len) {
+	size_t read_bytes = 0;
+	while (read_bytes < len) {
+		const size_t r = SDL_RWread(source, dest + read_bytes, 1, len - read_bytes);
+		if (r == 0) return false;
+		read_bytes += r;
+	}
+	return true;
 }
 
-Sint64 compressSeek(SDL_RWops*, Sint64, int) {
-	return -1;
+static void write_le32(unsigned char* dest, const Uint32 val) {
+	dest[0] = static_cast<unsigned char>(val);
+	dest[1] = static_cast<unsigned char>(val >> 8);
+	dest[2] = static_cast<unsigned char>(val >> 16);
+	dest[3] = static_cast<unsigned char>(val >> 24);
 }
 
-size_t compressRead(SDL_RWops* ptr, void* dest, size_t size, size_t num) {
-	if (num == 0 || size == 0) {
-		return 0;
+static Uint32 read_le32(const unsigned char* src) {
+	return static_cast<Uint32>(src[0]) | (static_cast<Uint32>(src[1]) << 8) |
+		(static_cast<Uint32>(src[2]) << 16) | (static_cast<Uint32>(src[3]) << 24);
+}
+
+/*
+ * Stored codec
+ */
+static bool stored_init(CompressData*, bool, int) {
+	return true;
+}
+
+static unsigned stored_read(CompressData* comp_data, unsigned char* dest, const unsigned len) {
+	return static_cast<unsigned>(SDL_RWread(comp_data->source, dest, 1, len));
+}
+
+static unsigned stored_write(CompressData* comp_data, const unsigned char* data, const unsigned len) {
+	return static_cast<unsigned>(SDL_RWwrite(comp_data->source, data, 1, len));
+}
+
+static void stored_finish(CompressData*) {}
+
+static void stored_end(CompressData*) {}
+
+/*
+ * zlib and raw deflate codecs, sharing everything but the window bits given at init.
+ */
+static bool zlib_init(CompressData* comp_data, const bool def, const int level, const int window_bits) {
+	z_stream* zstream = &comp_data->stream;
+	zstream->zalloc = Z_NULL;
+	zstream->zfree = Z_NULL;
+	zstream->opaque = Z_NULL;
+	int ret;
+	if (def) {
+		comp_data->data_filter = deflate;
+		comp_data->end_filter = deflateEnd;
+		ret = deflateInit2(zstream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY);
+	} else {
+		comp_data->data_filter = inflate;
+		comp_data->end_filter = inflateEnd;
+		ret = inflateInit2(zstream, window_bits);
 	}
-	
-	const unsigned target = static_cast<unsigned>(size * num > UINT_MAX ?  (UINT_MAX / size) * size : size * num);
+	if (ret != Z_OK) {
+		return false;
+	}
+	zstream->next_in = nullptr;
+	zstream->next_out = nullptr;
+	zstream->avail_in = 0;
+	zstream->avail_out = 0;
+	return true;
+}
+
+static bool zlib_init(CompressData* comp_data, const bool def, const int level) {
+	return zlib_init(comp_data, def, level, MAX_WBITS);
+}
 
+static bool raw_deflate_init(CompressData* comp_data, const bool def, const int level) {
+	return zlib_init(comp_data, def, level, -MAX_WBITS);
+}
+
+static unsigned zlib_read(CompressData* comp_data, unsigned char* dest, const unsigned target) {
 	unsigned read_bytes = 0;
-	SDL_RWops* source = static_cast<SDL_RWops*>(ptr->hidden.unknown.data1);
-	CompressData* comp_data = static_cast<CompressData*>(ptr->hidden.unknown.data2);
+	SDL_RWops* source = comp_data->source;
 	z_stream* strm = &comp_data->stream;
-	
-	if(strm->next_out != nullptr) {
-		// This stream is being used to write data
-		return 0;
-	}
-	
+
 	strm->avail_out =  target;
-	strm->next_out = static_cast<unsigned char*>(dest);
-	
+	strm->next_out = dest;
+
 	if (strm->next_in == nullptr) {
 		strm->next_in = comp_data->buffer;
 		strm->avail_in = 0;
@@ -65,26 +168,15 @@ size_t compressRead(SDL_RWops* ptr, void* dest, size_t size, size_t num) {
 	}
 	strm->next_out = nullptr;
 	strm->avail_out = 0;
-	return read_bytes / size;
-} 
-
-size_t compressWrite(SDL_RWops* ptr, const void* data, size_t size, size_t num) {
-	if (num == 0 || size == 0) {
-		return 0;
-	}
+	return read_bytes;
+}
 
-	const unsigned target = static_cast<unsigned>(size * num > UINT_MAX ? (UINT_MAX / size) * size : size * num);
-	
+static unsigned zlib_write(CompressData* comp_data, const unsigned char* data, const unsigned target) {
 	unsigned consumed_bytes = 0;
-	SDL_RWops* source = static_cast<SDL_RWops*>(ptr->hidden.unknown.data1);
-	CompressData* comp_data = static_cast<CompressData*>(ptr->hidden.unknown.data2);
+	SDL_RWops* source = comp_data->source;
 	z_stream* strm = &comp_data->stream;
-	if (strm->next_in != nullptr) {
-		// This stream is being used to read data
-		return 0;
-	}
 
-	strm->next_in = static_cast<const unsigned char*>(data);
+	strm->next_in = data;
 	strm->avail_in = target;
 
 	if (comp_data->buffer_pos > 0) {
@@ -97,11 +189,6 @@ size_t compressWrite(SDL_RWops* ptr, const void* data, size_t size, size_t num)
 		comp_data->buffer_pos = 0;
 	}
 
-	if (strm->next_out == nullptr) {
-		strm->next_out = comp_data->buffer;
-		strm->avail_out = BUFFER_SIZE;
-	}
-	
 	while (true) {
 		strm->next_out = comp_data->buffer;
 		strm->avail_out = BUFFER_SIZE;
@@ -123,36 +210,299 @@ size_t compressWrite(SDL_RWops* ptr, const void* data, size_t size, size_t num)
 	}
 	strm->next_in = nullptr;
 	strm->avail_in = 0;
-	return consumed_bytes / size;
-} 
+	return consumed_bytes;
+}
+
+static void zlib_finish(CompressData* comp_data) {
+	z_stream* strm = &comp_data->stream;
+	while (true) {
+		strm->avail_in = 0;
+		strm->avail_out = BUFFER_SIZE;
+		strm->next_out = comp_data->buffer;
+		int ret = comp_data->data_filter(strm, Z_FINISH);
+		if (ret != Z_OK && ret != Z_BUF_ERROR && ret != Z_STREAM_END) {
+			break;
+		}
+		const unsigned have = BUFFER_SIZE - strm->avail_out;
+		const unsigned out = static_cast<unsigned>(SDL_RWwrite(comp_data->source, comp_data->buffer, 1, have));
+		if (out < have) {
+			break;
+		}
+		if (ret == Z_STREAM_END || (ret == Z_BUF_ERROR && strm->avail_out == BUFFER_SIZE)) {
+			break;
+		}
+	}
+}
+
+static void zlib_end(CompressData* comp_data) {
+	comp_data->end_filter(&comp_data->stream);
+}
+
+/*
+ * LZ codec. The stream is a sequence of independent blocks of at most LZ_BLOCK_SIZE bytes,
+ * each starting with the uncompressed and compressed size (little endian Uint32).
+ * A compressed block is a list of sequences:
+ *   token (literal length << 4 | match length - 4), where 15 means more length bytes follow,
+ *   literals, 16-bit offset back into the block, more match length bytes.
+ * The last sequence of a block only contains literals.
+ */
+static bool lz_init(CompressData* comp_data, const bool def, int) {
+	comp_data->block = std::make_unique<unsigned char[]>(LZ_BLOCK_SIZE + LZ_COPY_SLACK);
+	if (def) {
+		comp_data->hash_table = std::make_unique<Uint32[]>(1 << LZ_HASH_BITS);
+	}
+	comp_data->block_len = 0;
+	comp_data->block_pos = 0;
+	return true;
+}
+
+static unsigned char* lz_write_length(unsigned char* op, unsigned len) {
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = static_cast<unsigned char>(len);
+	return op;
+}
+
+static unsigned char* lz_write_sequence(unsigned char* op, const unsigned char* literals, const unsigned lit_len,
+								 const unsigned offset, const unsigned match_len) {
+	const unsigned ml = match_len - LZ_MIN_MATCH;
+	*op++ = static_cast<unsigned char>((std::min(lit_len, 15u) << 4) | std::min(ml, 15u));
+	if (lit_len >= 15) {
+		op = lz_write_length(op, lit_len - 15);
+	}
+	memcpy(op, literals, lit_len);
+	op += lit_len;
+	*op++ = static_cast<unsigned char>(offset);
+	*op++ = static_cast<unsigned char>(offset >> 8);
+	if (ml >= 15) {
+		op = lz_write_length(op, ml - 15);
+	}
+	return op;
+}
+
+/**
+ * Compresses len bytes from in into out, returning the compressed size.
+ */
+static unsigned lz_compress_block(const unsigned char* in, const unsigned len, unsigned char* out, Uint32* table) {
+	constexpr Uint32 EMPTY = 0xFFFFFFFF;
+	std::fill(table, table + (1 << LZ_HASH_BITS), EMPTY);
+	unsigned char* op = out;
+	unsigned ip = 0, anchor = 0;
+	while (ip + LZ_MIN_MATCH <= len) {
+		Uint32 seq;
+		memcpy(&seq, in + ip, sizeof(seq));
+		const Uint32 hash = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+		const Uint32 ref = table[hash];
+		table[hash] = ip;
+		if (ref == EMPTY || memcmp(in + ref, &seq, sizeof(seq)) != 0) {
+			++ip;
+			continue;
+		}
+		unsigned match_len = LZ_MIN_MATCH;
+		while (ip + match_len < len && in[ref + match_len] == in[ip + match_len]) {
+			++match_len;
+		}
+		op = lz_write_sequence(op, in + anchor, ip - anchor, ip - ref, match_len);
+		ip += match_len;
+		anchor = ip;
+	}
+	const unsigned lit_len = len - anchor;
+	*op++ = static_cast<unsigned char>(std::min(lit_len, 15u) << 4);
+	if (lit_len >= 15) {
+		op = lz_write_length(op, lit_len - 15);
+	}
+	memcpy(op, in + anchor, lit_len);
+	op += lit_len;
+	return static_cast<unsigned>(op - out);
+}
+
+/**
+ * Reads a length continuation, returning false if the input ends.
+ */
+static bool lz_read_length(const unsigned char* &ip, const unsigned char* end, unsigned &len) {
+	unsigned char c;
+	do {
+		if (ip == end) return false;
+		c = *ip++;
+		len += c;
+	} while (c == 255);
+	return true;
+}
+
+/**
+ * Decompresses the block in into out, which has room for out_len bytes.
+ * Returns false if the block is malformed or does not decompress to exactly out_len bytes.
+ */
+static bool lz_decompress_block(const unsigned char* ip, const unsigned in_len, unsigned char* out, const unsigned out_len) {
+	const unsigned char* const end = ip + in_len;
+	unsigned char* op = out;
+	unsigned char* const out_end = out + out_len;
+	while (ip < end) {
+		const unsigned token = *ip++;
+		unsigned lit_len = token >> 4;
+		if (lit_len == 15 && !lz_read_length(ip, end, lit_len)) return false;
+		if (lit_len > static_cast<unsigned>(end - ip) || lit_len > static_cast<unsigned>(out_end - op)) return false;
+		// Short runs are copied with a fixed size, using the slack after both buffers.
+		if (lit_len <= LZ_COPY_SLACK) {
+			memcpy(op, ip, LZ_COPY_SLACK);
+		} else {
+			memcpy(op, ip, lit_len);
+		}
+		op += lit_len;
+		ip += lit_len;
+		if (ip == end) break;
+
+		if (end - ip < 2) return false;
+		const unsigned offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		unsigned match_len = token & 0x0F;
+		if (match_len == 15 && !lz_read_length(ip, end, match_len)) return false;
+		match_len += LZ_MIN_MATCH;
+		if (offset == 0 || offset > static_cast<unsigned>(op - out) || match_len > static_cast<unsigned>(out_end - op)) {
+			return false;
+		}
+		const unsigned char* match = op - offset;
+		if (offset >= LZ_COPY_SLACK && match_len <= LZ_COPY_SLACK) {
+			memcpy(op, match, LZ_COPY_SLACK);
+			op += match_len;
+			continue;
+		}
+		// Overlapping matches repeat the last offset bytes. Copying what has been written so far
+		// doubles the copied length every iteration, instead of going byte by byte.
+		while (match_len > 0) {
+			const unsigned n = std::min(match_len, static_cast<unsigned>(op - match));
+			memcpy(op, match, n);
+			op += n;
+			match_len -= n;
+		}
+	}
+	return op == out_end;
+}
+
+static bool lz_next_block(CompressData* comp_data) {
+	unsigned char header[LZ_BLOCK_HEADER];
+	if (!read_fully(comp_data->source, header, LZ_BLOCK_HEADER)) return false;
+	const Uint32 raw_len = read_le32(header);
+	const Uint32 comp_len = read_le32(header + 4);
+	const Uint32 data_len = comp_len & ~LZ_RAW_FLAG;
+	if (raw_len > LZ_BLOCK_SIZE || data_len > BUFFER_SIZE - LZ_COPY_SLACK) return false;
+
+	if (comp_len & LZ_RAW_FLAG) {
+		if (data_len != raw_len || !read_fully(comp_data->source, comp_data->block.get(), raw_len)) return false;
+	} else {
+		if (!read_fully(comp_data->source, comp_data->buffer, data_len)) return false;
+		if (!lz_decompress_block(comp_data->buffer, data_len, comp_data->block.get(), raw_len)) return false;
+	}
+	comp_data->block_len = raw_len;
+	comp_data->block_pos = 0;
+	return true;
+}
+
+static unsigned lz_read(CompressData* comp_data, unsigned char* dest, const unsigned target) {
+	unsigned read_bytes = 0;
+	while (read_bytes < target) {
+		if (comp_data->block_pos == comp_data->block_len && !lz_next_block(comp_data)) {
+			break;
+		}
+		const unsigned n = std::min(target - read_bytes, comp_data->block_len - comp_data->block_pos);
+		memcpy(dest + read_bytes, comp_data->block.get() + comp_data->block_pos, n);
+		comp_data->block_pos += n;
+		read_bytes += n;
+	}
+	return read_bytes;
+}
+
+static bool lz_flush_block(CompressData* comp_data) {
+	const unsigned raw_len = comp_data->block_len;
+	unsigned char* out = comp_data->buffer + LZ_BLOCK_HEADER;
+	unsigned comp_len = lz_compress_block(comp_data->block.get(), raw_len, out, comp_data->hash_table.get());
+	Uint32 flags = 0;
+	if (comp_len >= raw_len) {
+		memcpy(out, comp_data->block.get(), raw_len);
+		comp_len = raw_len;
+		flags = LZ_RAW_FLAG;
+	}
+	write_le32(comp_data->buffer, raw_len);
+	write_le32(comp_data->buffer + 4, comp_len | flags);
+	comp_data->block_len = 0;
+	const size_t total = LZ_BLOCK_HEADER + comp_len;
+	return SDL_RWwrite(comp_data->source, comp_data->buffer, 1, total) == total;
+}
+
+static unsigned lz_write(CompressData* comp_data, const unsigned char* data, const unsigned target) {
+	unsigned consumed_bytes = 0;
+	while (consumed_bytes < target) {
+		const unsigned n = std::min(target - consumed_bytes, LZ_BLOCK_SIZE - comp_data->block_len);
+		memcpy(comp_data->block.get() + comp_data->block_len, data + consumed_bytes, n);
+		comp_data->block_len += n;
+		consumed_bytes += n;
+		if (comp_data->block_len == LZ_BLOCK_SIZE && !lz_flush_block(comp_data)) {
+			break;
+		}
+	}
+	return consumed_bytes;
+}
+
+static void lz_finish(CompressData* comp_data) {
+	if (comp_data->block_len > 0) {
+		lz_flush_block(comp_data);
+	}
+}
+
+static void lz_end(CompressData*) {}
+
+// Codec registry, indexed by Codec.
+static const CodecOps CODECS[static_cast<int>(Codec::TOTAL)] = {
+	{stored_init, stored_read, stored_write, stored_finish, stored_end},
+	{zlib_init, zlib_read, zlib_write, zlib_finish, zlib_end},
+	{raw_deflate_init, zlib_read, zlib_write, zlib_finish, zlib_end},
+	{lz_init, lz_read, lz_write, lz_finish, lz_end}
+};
+
+Sint64 compressSize(SDL_RWops*) {
+	return -1;
+}
+
+Sint64 compressSeek(SDL_RWops*, Sint64, int) {
+	return -1;
+}
+
+size_t compressRead(SDL_RWops* ptr, void* dest, size_t size, size_t num) {
+	if (num == 0 || size == 0) {
+		return 0;
+	}
+	CompressData* comp_data = static_cast<CompressData*>(ptr->hidden.unknown.data2);
+	if (comp_data->def) {
+		// This stream is being used to write data
+		return 0;
+	}
+	const unsigned target = static_cast<unsigned>(size * num > UINT_MAX ?  (UINT_MAX / size) * size : size * num);
+	return comp_data->ops->read(comp_data, static_cast<unsigned char*>(dest), target) / size;
+}
+
+size_t compressWrite(SDL_RWops* ptr, const void* data, size_t size, size_t num) {
+	if (num == 0 || size == 0) {
+		return 0;
+	}
+	CompressData* comp_data = static_cast<CompressData*>(ptr->hidden.unknown.data2);
+	if (!comp_data->def) {
+		// This stream is being used to read data
+		return 0;
+	}
+	const unsigned target = static_cast<unsigned>(size * num > UINT_MAX ? (UINT_MAX / size) * size : size * num);
+	return comp_data->ops->write(comp_data, static_cast<const unsigned char*>(data), target) / size;
+}
 
 int compressClose(SDL_RWops* ptr) {
 	SDL_RWops* source = static_cast<SDL_RWops*>(ptr->hidden.unknown.data1);
 	CompressData* comp_data = static_cast<CompressData*>(ptr->hidden.unknown.data2);
-	z_stream* strm = &comp_data->stream;
-	
-	if (strm->next_in == nullptr && strm->next_out != nullptr) {
-		while (true) {
-			strm->avail_in = 0;
-			strm->avail_out = BUFFER_SIZE;
-			strm->next_out = comp_data->buffer;
-			int ret = comp_data->data_filter(strm, Z_FINISH);
-			if (ret != Z_OK && ret != Z_BUF_ERROR && ret != Z_STREAM_END) {
-				break;
-			}
-			const unsigned have = BUFFER_SIZE - strm->avail_out;
-			const unsigned out = static_cast<unsigned>(SDL_RWwrite(source, comp_data->buffer, 1, have));
-			if (out < have) {
-				break;
-			}
-			if (ret == Z_STREAM_END || (ret == Z_BUF_ERROR && strm->avail_out == BUFFER_SIZE)) {
-				break;
-			}
-		}
-		
-	}
-	
-	comp_data->end_filter(strm);
+
+	if (comp_data->def) {
+		comp_data->ops->finish(comp_data);
+	}
+	comp_data->ops->end(comp_data);
 
 	int ret = source->close(source);
 	delete comp_data;
@@ -161,42 +511,25 @@ int compressClose(SDL_RWops* ptr) {
 	return ret;
 }
 
-SDL_RWops* SDL_RWcompress(SDL_RWops* source, bool def) {
-	if (source == nullptr) 
+SDL_RWops* SDL_RWcompress(SDL_RWops* source, const bool def, const Codec codec, const int level) {
+	if (source == nullptr || codec >= Codec::TOTAL)
 		return nullptr;
 	SDL_RWops* compressor = SDL_AllocRW();
-	if (compressor == nullptr) 
+	if (compressor == nullptr)
 		return nullptr;
 
 	CompressData* comp_data = new CompressData();
-	z_stream* zstream = &comp_data->stream;
+	comp_data->source = source;
+	comp_data->ops = &CODECS[static_cast<int>(codec)];
+	comp_data->def = def;
 	comp_data->buffer_pos = 0;
 
-	zstream->zalloc = Z_NULL;
-    zstream->zfree = Z_NULL;
-    zstream->opaque = Z_NULL;
-	int ret;
-	if (def) {
-		comp_data->data_filter = deflate;
-		comp_data->end_filter = deflateEnd;
-		ret = deflateInit(zstream, Z_DEFAULT_COMPRESSION);
-	} else {
-		comp_data->data_filter = inflate;
-		comp_data->end_filter = inflateEnd;
-		ret = inflateInit(zstream);
-	}
-	
-	if (ret != Z_OK) {
+	if (!comp_data->ops->init(comp_data, def, level)) {
 		delete comp_data;
 		SDL_FreeRW(compressor);
 		return nullptr;
 	}
 
-	zstream->next_in = nullptr;
-	zstream->next_out = nullptr;
-	zstream->avail_in = 0;
-	zstream->avail_out = 0;
-
 	compressor->size = compressSize;
 	compressor->seek = compressSeek;
 	compressor->read = compressRead;
@@ -208,9 +541,38 @@ SDL_RWops* SDL_RWcompress(SDL_RWops* source, bool def) {
 }
 
 SDL_RWops* SDL_RWinflate(SDL_RWops* source) {
-	return SDL_RWcompress(source, false);
+	Uint8 header;
+	if (source == nullptr || SDL_RWread(source, &header, 1, 1) != 1) {
+		return nullptr;
+	}
+	if ((header & 0xF0) == HEADER_MAGIC) {
+		return SDL_RWcompress(source, false, static_cast<Codec>(header & 0x0F), DEFAULT_COMPRESSION_LEVEL);
+	}
+	if ((header & 0x0F) != Z_DEFLATED) {
+		return nullptr;
+	}
+	// Headerless zlib stream, the byte already read belongs to the stream.
+	SDL_RWops* inflater = SDL_RWcompress(source, false, Codec::ZLIB, DEFAULT_COMPRESSION_LEVEL);
+	if (inflater != nullptr) {
+		CompressData* comp_data = static_cast<CompressData*>(inflater->hidden.unknown.data2);
+		comp_data->buffer[0] = header;
+		comp_data->stream.next_in = comp_data->buffer;
+		comp_data->stream.avail_in = 1;
+	}
+	return inflater;
 }
 
 SDL_RWops* SDL_RWdeflate(SDL_RWops* source) {
-	return SDL_RWcompress(source, true);
+	return SDL_RWdeflate(source, Codec::ZLIB, DEFAULT_COMPRESSION_LEVEL);
+}
+
+SDL_RWops* SDL_RWdeflate(SDL_RWops* source, const Codec codec, const int level) {
+	if (source == nullptr || codec >= Codec::TOTAL) {
+		return nullptr;
+	}
+	const Uint8 header = HEADER_MAGIC | static_cast<Uint8>(codec);
+	if (SDL_RWwrite(source, &header, 1, 1) != 1) {
+		return nullptr;
+	}
+	return SDL_RWcompress(source, true, codec, level);
 }
\ No newline at end of file
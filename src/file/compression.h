@@ -1,8 +1,40 @@
 #ifndef COMPRESSION_00_H
 #define COMPRESSION_00_H
+#include <SDL.h>
 
+/**
+ * Codecs available for compressed streams. A compressed stream starts with a single
+ * header byte (0xA0 | codec) so that readers can pick the right decoder.
+ * Streams starting with a plain zlib header (written before codecs existed) are read as ZLIB.
+ */
+enum class Codec : Uint8 {
+	STORED = 0,		// No compression, only the header byte.
+	ZLIB = 1,		// zlib stream, level selectable.
+	DEFLATE = 2,	// Raw deflate stream without zlib header and checksum, level selectable.
+	LZ = 3,			// In-tree LZ codec, fast to decode but with a worse ratio than ZLIB.
+	TOTAL = 4
+};
+
+// Lets the codec pick its default level.
+constexpr int DEFAULT_COMPRESSION_LEVEL = -1;
+
+/**
+ * Wraps source in a stream that decompresses data read from it.
+ * The codec is detected from the header byte. Returns nullptr if the stream could not be created,
+ * in which case source is left open.
+ */
 SDL_RWops* SDL_RWinflate(SDL_RWops* source);
 
+/**
+ * Wraps source in a stream that compresses data written to it using zlib at the default level.
+ */
 SDL_RWops* SDL_RWdeflate(SDL_RWops* source);
 
+/**
+ * Wraps source in a stream that compresses data written to it using codec.
+ * Level is passed to the codec (0-9 for ZLIB and DEFLATE), and ignored by codecs without levels.
+ * Returns nullptr if the stream could not be created, in which case source is left open.
+ */
+SDL_RWops* SDL_RWdeflate(SDL_RWops* source, Codec codec, int level);
+
 #endif
\ No newline at end of file
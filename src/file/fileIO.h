@@ -7,6 +7,20 @@
 #include "util/exceptions.h"
 #include "compression.h"
 
+/**
+ * Deleter for buffers allocated by SDL.
+ */
+struct SDLFreeDeleter {
+	void operator()(void* p) {SDL_free(p);}
+};
+
+/**
+ * Deleter closing a SDL_RWops.
+ */
+struct RWopsDeleter {
+	void operator()(SDL_RWops* rw) {SDL_RWclose(rw);}
+};
+
 /**
  * file_exception, for when opening a file fails.
  */
@@ -36,10 +50,13 @@ class FileReader {
 				throw file_exception("File exception: " + std::string(SDL_GetError()));
 			}
 			if (compression) {
-				in = SDL_RWinflate(in);
-				if (in == nullptr) {
+				// The codec is detected from the header of the file.
+				SDL_RWops* inflater = SDL_RWinflate(in);
+				if (inflater == nullptr) {
+					SDL_RWclose(in);
 					throw file_exception("File exception: could not initialize inflation");
 				}
+				in = inflater;
 			}
 			index = -1;
 			max = static_cast<long>(SDL_RWread(in, &buffer, sizeof(char), BUFFER_SIZE * sizeof(char)));
@@ -253,54 +270,109 @@ class FileReader {
 
 class FileWriter {
 	public:
+		/**
+		 * Opens file_name for writing, compressing the data with codec at level.
+		 */
+		FileWriter(const std::string& file_name, bool binary, Codec codec, int level) {
+			out = SDL_RWFromFile(file_name.c_str(), binary ? "wb" : "w");
+			if (out == nullptr) {
+				throw file_exception("Could not open file, " + std::string(SDL_GetError()));
+			}
+			SDL_RWops* deflater = SDL_RWdeflate(out, codec, level);
+			if (deflater == nullptr) {
+				SDL_RWclose(out);
+				throw file_exception("Could not initialize deflation.");
+			}
+			out = deflater;
+		}
+
+		FileWriter(const std::string& file_name, bool binary, Codec codec) : 
+			FileWriter(file_name, binary, codec, DEFAULT_COMPRESSION_LEVEL) {}
+
 		FileWriter(const std::string& file_name, bool binary, bool compression) {
 			out = SDL_RWFromFile(file_name.c_str(), binary ? "wb" : "w");
 			if (out == nullptr) {
 				throw file_exception("Could not open file, " + std::string(SDL_GetError()));
 			}
 			if (compression) {
-				out = SDL_RWdeflate(out);
-				if (out == nullptr) {
+				SDL_RWops* deflater = SDL_RWdeflate(out);
+				if (deflater == nullptr) {
+					SDL_RWclose(out);
 					throw file_exception("Could not initialize deflation.");
 				}
+				out = deflater;
 			}
 		}
 		
 		FileWriter(const std::string& file_name, bool binary) : FileWriter(file_name, binary, false) {}
 		
 		~FileWriter() {
+			flush();
 			SDL_RWclose(out);
 		}
+
+		FileWriter(const FileWriter&) = delete;
+		FileWriter& operator=(const FileWriter&) = delete;
 		
 		bool write(const std::string &s) {
-			size_t written = SDL_RWwrite(out, s.c_str(), 1, s.length());
-			return written == s.length();
+			return put(s.c_str(), s.length());
 		}
 		
 		bool write(const char *s, size_t len) {
-			size_t written = SDL_RWwrite(out, s, 1, len + 1);
-			return written == len + 1;	
+			return put(s, len + 1);
 		}
 		
 		bool write(const char c) {
-			return SDL_RWwrite(out, &c, 1, 1) == 1;	
+			return put(&c, 1);
 		}
 		
 		bool write(const int i) {
-			return SDL_RWwrite(out, &i, sizeof(i), 1) == 1;
+			return put(&i, sizeof(i));
 		}
 		
 		template<class T>
 		bool write(const T& t) {
-			return SDL_RWwrite(out, &t, sizeof(T), 1) == 1;
+			return put(&t, sizeof(T));
 		}
 
 		template<class T>
 		bool write_many(const T* t, const int count) {
-			return SDL_RWwrite(out, t, sizeof(T), count) == count;
+			return put(t, sizeof(T) * count);
+		}
+
+		/**
+		 * Writes all buffered data to the file. Returns false if the write failed.
+		 */
+		bool flush() {
+			if (buffered == 0) return true;
+			const size_t written = SDL_RWwrite(out, buffer, 1, buffered);
+			const bool ok = written == buffered;
+			buffered = 0;
+			return ok;
 		}
 
 	private:
+		/**
+		 * Copies len bytes into the buffer, writing through when it is full.
+		 * Data is only written when the buffer is flushed, so errors may show up on a later call or on flush.
+		 */
+		bool put(const void* data, const size_t len) {
+			if (buffered + len > BUFFER_SIZE) {
+				if (!flush()) return false;
+				if (len >= BUFFER_SIZE) {
+					return SDL_RWwrite(out, data, 1, len) == len;
+				}
+			}
+			memcpy(buffer + buffered, data, len);
+			buffered += len;
+			return true;
+		}
+
+		static const size_t BUFFER_SIZE = 4096;
+
+		char buffer[BUFFER_SIZE] {};
+		size_t buffered = 0;
+
 		SDL_RWops *out;
 };
 
@@ -1,27 +1,82 @@
+#include <algorithm>
 #include <cmath>
-#include <sstream>
-#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 #include "json.h"
 #include "fileIO.h"
+#include "engine/profiler.h"
+
+// Size of the window used when streaming a file.
+constexpr size_t STREAM_BUFFER_SIZE = 64 * 1024;
+
+/**
+ * Parser state. cur points to the next character to read, and end one past the last buffered character.
+ * When the whole input is in memory source is nullptr. When streaming, the window is refilled from source,
+ * keeping everything from mark (the start of the current token) if it is set.
+ */
+struct JsonParser {
+	const char* begin;
+	const char* cur;
+	const char* end;
+	const char* mark;
+
+	SDL_RWops* source;
+	std::vector<char> buffer;
+	// Row and column of begin, advanced when the window moves.
+	int row;
+	int col;
+
+	// Holds strings containing escapes, other strings are viewed directly in the buffer.
+	std::string scratch;
+};
+
+/**
+ * Advances row and col over the characters in [from, to).
+ */
+void advance_position(const char* from, const char* to, int &row, int &col) {
+	for (const char* c = from; c < to; ++c) {
+		col++;
+		if (*c == '\n') {
+			col = 1;
+			row++;
+		} else if (*c == '\t') {
+			col += 4;
+		}
+	}
+}
 
+/**
+ * Gets the row and column of pos. Only used when reporting errors, so it scans from the beginning of the window.
+ */
+void get_position(const JsonParser &in, const char* pos, int &row, int &col) {
+	row = in.row;
+	col = in.col;
+	advance_position(in.begin, pos, row, col);
+}
 
-
-json_exception expected_char(char c, FileReader &in) {
+json_exception expected_char(char c, const JsonParser &in) {
 	int row, col;
-	in.get_position(row, col);
+	get_position(in, in.cur, row, col);
 	return json_exception("Expected a '" + std::string(1, c) + "' at row " + std::to_string(row) + " , col " + std::to_string(col));
 }
 
-json_exception unexpected_char(char c, FileReader &in) {
+json_exception unexpected_char(const JsonParser &in) {
 	int row, col;
-	in.get_position(row, col);
-	return json_exception("Unexpected character '" + std::string(1, c) + "' at row " + std::to_string(row) + " , col " + std::to_string(col));
+	get_position(in, in.cur, row, col);
+	return json_exception("Unexpected character '" + std::string(1, *in.cur) + "' at row " + std::to_string(row) + " , col " + std::to_string(col));
 }
 
-json_exception to_big_number(FileReader &in) {
+json_exception to_big_number(const JsonParser &in) {
 	int row, col;
-	in.get_position(row, col); \
+	get_position(in, in.cur, row, col);
 	return json_exception("To big number at row " + std::to_string(row) + " , col " + std::to_string(col));
 }
 
@@ -29,373 +84,844 @@ json_exception end_of_file() {
 	return json_exception("Unexpected end of file");
 }
 
-void skip_spacing(FileReader &in);
+/**
+ * Reads more input into the window when streaming. Everything from mark, or from cur if there is no mark,
+ * is moved to the start of the buffer, which grows if a single token fills it.
+ * Returns false if there is no more input.
+ */
+bool refill(JsonParser &in) {
+	if (in.source == nullptr) return false;
+	const char* keep = in.mark != nullptr ? in.mark : in.cur;
+	advance_position(in.begin, keep, in.row, in.col);
+	const size_t kept = in.end - keep;
+	const size_t cur_offset = in.cur - keep;
+	memmove(in.buffer.data(), keep, kept);
+	if (kept == in.buffer.size()) {
+		in.buffer.resize(in.buffer.size() * 2);
+	}
+	const size_t read = SDL_RWread(in.source, in.buffer.data() + kept, 1, in.buffer.size() - kept);
+	in.begin = in.buffer.data();
+	if (in.mark != nullptr) in.mark = in.begin;
+	in.cur = in.begin + cur_offset;
+	in.end = in.begin + kept + read;
+	return read > 0;
+}
+
+/**
+ * Returns true if all input has been read, refilling the window if needed.
+ */
+bool at_end(JsonParser &in) {
+	return in.cur == in.end && !refill(in);
+}
+
+void skip_spacing(JsonParser &in);
+
+void validate_char(JsonParser &in, char c);
+
+void read_matching(JsonParser &in, const char* s);
 
-void validate_char(FileReader &in, char c);
+bool read_number(JsonParser &in, int &i_val, double &d_val);
 
-JsonObject read_object(FileReader &in);
+/**
+ * Reads a string, returning a view into the window if it has no escapes and into in.scratch otherwise.
+ * The view is only valid until the parser reads further.
+ */
+std::string_view read_string_view(JsonParser &in);
 
-JsonList read_list(FileReader &in);
+/**
+ * Skips a value without reading it. Skipped objects and lists are only checked for balanced brackets.
+ */
+void skip_value(JsonParser &in);
 
-void read_matching(FileReader &in, const std::string& s);
+/*
+ * SWAR helpers, testing 8 characters at a time.
+ */
+constexpr uint64_t SWAR_LOW = 0x7F7F7F7F7F7F7F7Full;
+constexpr uint64_t SWAR_HIGH = 0x8080808080808080ull;
 
-bool read_number(FileReader &in, int &i_val, double &d_val);
+uint64_t load_word(const char* p) {
+	uint64_t w;
+	memcpy(&w, p, sizeof(w));
+	return w;
+}
+
+/**
+ * Returns a word with the high bit set in every byte of w equal to c.
+ */
+uint64_t bytes_equal(const uint64_t w, const char c) {
+	const uint64_t x = w ^ (0x0101010101010101ull * static_cast<unsigned char>(c));
+	return ~(((x & SWAR_LOW) + SWAR_LOW) | x) & SWAR_HIGH;
+}
 
-void to_pretty_stream(std::ostream& os, const json::Type& val, int indentations);
+bool is_space(const char c) {
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
 
-std::string read_string(FileReader &in);
+bool is_digit(const char c) {
+	return c - '0' <= 9 && c - '0' >= 0;
+}
 
-void read_matching(FileReader &in, const std::string& s) {
-	char c;
-	if (!in.read_cur(c)) throw end_of_file();
-	for (const char c1 : s) {
-		if (c != c1) throw unexpected_char(c, in);
-		if (!in.read_next(c)) throw end_of_file();
+void read_matching(JsonParser &in, const char* s) {
+	for (; *s != '\0'; ++s, ++in.cur) {
+		if (at_end(in)) throw end_of_file();
+		if (*in.cur != *s) throw unexpected_char(in);
 	}
-	in.soft_back();
-	
 }
 
-void validate_char(FileReader &in, char c) {
-	char c1;
-	if (!in.read_cur(c1)) throw end_of_file();
-	if (c != c1) throw expected_char(c, in);
+void validate_char(JsonParser &in, char c) {
+	if (at_end(in)) throw end_of_file();
+	if (*in.cur != c) throw expected_char(c, in);
+	++in.cur;
 }
 
+/**
+ * Skips a run of digits, throwing if there is not at least one.
+ */
+void skip_digits(JsonParser &in) {
+	if (at_end(in)) throw end_of_file();
+	if (!is_digit(*in.cur)) throw unexpected_char(in);
+	do {
+		++in.cur;
+	} while (!at_end(in) && is_digit(*in.cur));
+}
 
-bool read_number(FileReader &in, int &i_val, double &d_val) {
+bool read_number(JsonParser &in, int &i_val, double &d_val) {
+	// Validate the json number grammar first, then convert the whole span at once.
+	in.mark = in.cur;
 	bool is_int = true;
-	char c;
-	bool negative = false;
-	if (!in.read_cur(c)) throw end_of_file();
-	if (c == '-') {
-		negative = true;
-		if (!in.read_next(c)) throw end_of_file();
-		
-	} 
-	if (c == '0') {
-		if (!in.read_next(c) || c != '.') {
-			i_val = 0;
-			in.soft_back();
+	if (!at_end(in) && *in.cur == '-') {
+		++in.cur;
+	}
+	if (!at_end(in) && *in.cur == '0') {
+		++in.cur;
+	} else {
+		skip_digits(in);
+	}
+	if (!at_end(in) && *in.cur == '.') {
+		is_int = false;
+		++in.cur;
+		skip_digits(in);
+	}
+	if (!at_end(in) && (*in.cur == 'e' || *in.cur == 'E')) {
+		is_int = false;
+		++in.cur;
+		if (!at_end(in) && (*in.cur == '+' || *in.cur == '-')) {
+			++in.cur;
+		}
+		skip_digits(in);
+	}
+	const char* start = in.mark;
+	in.mark = nullptr;
+	if (is_int) {
+		const auto res = std::from_chars(start, in.cur, i_val);
+		if (res.ec == std::errc()) {
 			return true;
 		}
-		is_int = false;
-		if(!in.read_next(c)) throw end_of_file();
+		// Integers that do not fit in an int are read as doubles.
 	}
-	if (c - '0' > 9 || c - '0' < 0) {
-		throw unexpected_char(c, in);
+	const auto res = std::from_chars(start, in.cur, d_val);
+	if (res.ec == std::errc::result_out_of_range) {
+		// from_chars leaves d_val unspecified on underflow, strtod rounds it to 0 or a denormal.
+		d_val = std::strtod(std::string(start, in.cur).c_str(), nullptr);
+		if (std::isinf(d_val)) {
+			throw to_big_number(in);
+		}
 	}
-	i_val = 0;
-	d_val = 0;
-	double pos = 1;
+	return false;
+}
+
+std::string_view read_string_view(JsonParser &in) {
+	validate_char(in, '"');
+	in.mark = in.cur;
+	bool escaped = false;
 	while (true) {
-		if (c - '0' <= 9 && c - '0' >= 0) {
-			if (is_int) {
-				if (i_val > INT_MAX / 10) {
-					throw to_big_number(in);
-				} 
-				i_val *= 10;
-				i_val += (c - '0');
-			} else {
-				pos *= 10;
-				d_val += (c - '0') / pos;
-			}
-		} else if (c == '.') {
-			is_int = false;
-			d_val = (double)i_val;
-		} else if (c == 'E' || c == 'e') {
-			if (!in.read_next(c)) throw end_of_file();
-			bool negate_exp = false;
-			if (c == '-') negate_exp = true;
-			if (c == '+' || c == '-') {
-				if(!in.read_next(c)) throw end_of_file();
-			} 
-			double exp = 0;
-			int exp_pos = 1;
-			// Number with exponent is considered double.
-			if (c - '0' > 9 || c - '0' < 0) throw unexpected_char(c, in);
-			while (c - '0' <= 9 && c - '0' >= 0) {
-				exp *= exp_pos;
-				exp += (c - '0');
-				exp_pos *= 10;
-				if (!in.read_next(c)) break;
-			}
-			if (negative) {
-				d_val *= -1;
+		// Find the next quote or backslash, skipping 8 characters at a time when possible.
+		while (in.end - in.cur >= 8) {
+			const uint64_t w = load_word(in.cur);
+			if ((bytes_equal(w, '"') | bytes_equal(w, '\\')) != 0) break;
+			in.cur += 8;
+		}
+		while (in.cur != in.end && *in.cur != '"' && *in.cur != '\\') {
+			++in.cur;
+		}
+		if (in.cur == in.end) {
+			if (!refill(in)) throw end_of_file();
+			if (escaped) {
+				// Escaped strings are built in scratch, so nothing before cur is needed.
+				in.scratch.append(in.mark, in.cur);
+				in.mark = in.cur;
 			}
-			in.soft_back();
-			errno = 0;
-			double factor = std::pow(10.0, exp);
-			if (errno == ERANGE) {
-				throw to_big_number(in);
+			continue;
+		}
+		if (!escaped) {
+			if (*in.cur == '"') {
+				// No escapes, the string can be used directly from the buffer.
+				const std::string_view s(in.mark, in.cur - in.mark);
+				in.mark = nullptr;
+				++in.cur;
+				return s;
 			}
-			d_val = d_val * factor;
-			return false;
+			escaped = true;
+			in.scratch.assign(in.mark, in.cur);
 		} else {
-			in.soft_back();
-			if (negative) {
-				i_val *= -1;
-				d_val *= -1;
-			}
-			return is_int;
+			in.scratch.append(in.mark, in.cur);
+		}
+		if (*in.cur == '"') {
+			in.mark = nullptr;
+			++in.cur;
+			return in.scratch;
+		}
+		++in.cur;
+		if (at_end(in)) throw end_of_file();
+		const char c = *in.cur++;
+		if (c == '\\' || c == '"' || c == '/') {
+			in.scratch.push_back(c);
+		} else if (c == 'n') {
+			in.scratch.push_back('\n');
+		} else if (c == 't') {
+			in.scratch.push_back('\t');
+		} else if (c == 'b') {
+			in.scratch.push_back('\b');
+		} else if (c == 'f') {
+			in.scratch.push_back('\f');
+		} else if (c == 'r') {
+			in.scratch.push_back('\r');
+		} else {
+			throw json_exception("Unsupported escape character: \\" + std::string(1, c));
+		}
+		in.mark = in.cur;
+	}
+}
+
+/**
+ * Skips a string, only looking at quotes and backslashes.
+ */
+void skip_string(JsonParser &in) {
+	validate_char(in, '"');
+	while (true) {
+		while (in.end - in.cur >= 8) {
+			const uint64_t w = load_word(in.cur);
+			if ((bytes_equal(w, '"') | bytes_equal(w, '\\')) != 0) break;
+			in.cur += 8;
+		}
+		while (in.cur != in.end && *in.cur != '"' && *in.cur != '\\') {
+			++in.cur;
+		}
+		if (at_end(in)) throw end_of_file();
+		if (*in.cur == '\\') {
+			++in.cur;
+			if (at_end(in)) throw end_of_file();
+			++in.cur;
+		} else if (*in.cur == '"') {
+			++in.cur;
+			return;
+		}
+	}
+}
+
+void skip_value(JsonParser &in) {
+	if (at_end(in)) throw end_of_file();
+	const char c = *in.cur;
+	if (c == '"') {
+		skip_string(in);
+		return;
+	}
+	if (c != '{' && c != '[') {
+		if (c == 't') read_matching(in, "true");
+		else if (c == 'f') read_matching(in, "false");
+		else if (c == 'n') read_matching(in, "null");
+		else if (c == '-' || is_digit(c)) {
+			int i_val;
+			double d_val;
+			read_number(in, i_val, d_val);
+		} else {
+			throw unexpected_char(in);
+		}
+		return;
+	}
+	// Openers of the lists and objects being skipped, so a closer of the wrong kind is caught.
+	std::string open;
+	do {
+		if (at_end(in)) throw end_of_file();
+		switch (*in.cur) {
+			case '{':
+			case '[':
+				open.push_back(*in.cur);
+				++in.cur;
+				break;
+			case '}':
+			case ']':
+				if (open.back() != (*in.cur == '}' ? '{' : '[')) throw unexpected_char(in);
+				open.pop_back();
+				++in.cur;
+				break;
+			case '"':
+				skip_string(in);
+				break;
+			default:
+				++in.cur;
+		}
+	} while (!open.empty());
+}
+
+void skip_spacing(JsonParser &in) {
+	while (true) {
+		// Indentation comes in long runs, test 8 characters at a time.
+		while (in.end - in.cur >= 8) {
+			const uint64_t w = load_word(in.cur);
+			const uint64_t spaces = bytes_equal(w, ' ') | bytes_equal(w, '\t') | bytes_equal(w, '\n') | bytes_equal(w, '\r');
+			if (spaces != SWAR_HIGH) break;
+			in.cur += 8;
+		}
+		while (in.cur != in.end && is_space(*in.cur)) {
+			++in.cur;
 		}
-		if(!in.read_next(c)) c = '\0';
+		if (in.cur != in.end || !refill(in)) return;
 	}
-	
 }
 
-JsonObject read_object(FileReader &in) {
-	char c;
+template<class Handler>
+void parse_value(JsonParser &in, Handler &handler);
+
+template<class Handler>
+void parse_object(JsonParser &in, Handler &handler) {
 	validate_char(in, '{');
-	JsonObject obj;
 	skip_spacing(in);
-	if (!in.read_cur(c)) throw end_of_file();
-	if (c == '}') {
-		return obj;
+	if (at_end(in)) throw end_of_file();
+	if (*in.cur == '}') {
+		++in.cur;
+		handler.end_object();
+		return;
 	}
 	while (true) {
-		std::string key = read_string(in);
+		// The key is only valid until the parser reads further, so it is handed over right away.
+		const bool wanted = handler.key(read_string_view(in));
 		skip_spacing(in);
 		validate_char(in, ':');
 		skip_spacing(in);
-		if (!in.read_cur(c)) throw end_of_file();
-		switch (c) {
-			case '"': {
-				std::string val = read_string(in);
-				obj.set(key, val);
-				break;
-			}
-			case '{' : {
-				JsonObject val = read_object(in);
-				obj.set(key, val);
-				break;
-			}
-			case '[' : {
-				JsonList val = read_list(in);
-				obj.set(key, val);
-				break;
-			}
-			case '-':
-			case '0':
-			case '1':
-			case '2':
-			case '3':				
-			case '4':				
-			case '5':				
-			case '6':				
-			case '7':				
-			case '8':				
-			case '9': {
-				int i_val;
-				double d_val;
-				if (read_number(in, i_val, d_val)) {
-					obj.set(key, i_val);
-				} else {
-					obj.set(key, d_val);
-				}
-				break;
-			}
-			case 'n': {
-				read_matching(in, "null");
-				obj.set(key, JsonNull());
-				break;
-			}
-			case 't': {
-				read_matching(in, "true");
-				obj.set<bool>(key, true);
-				break;
-			}
-			case 'f': {
-				read_matching(in, "false");
-				obj.set<bool>(key, false);
-				break;
-			}
-			default:
-				throw unexpected_char(c, in);
+		if (wanted) {
+			parse_value(in, handler);
+		} else {
+			skip_value(in);
 		}
 		skip_spacing(in);
-		if (!in.read_cur(c)) throw end_of_file();
-		if (c == '}') return obj;
-		if (c != ',') {
-			throw unexpected_char(c, in);
+		if (at_end(in)) throw end_of_file();
+		if (*in.cur == '}') {
+			++in.cur;
+			handler.end_object();
+			return;
 		}
+		if (*in.cur != ',') {
+			throw unexpected_char(in);
+		}
+		++in.cur;
 		skip_spacing(in);
 	}
 }
 
-JsonList read_list(FileReader &in) {
-	char c;
+template<class Handler>
+void parse_list(JsonParser &in, Handler &handler) {
 	validate_char(in, '[');
-	JsonList list;
 	skip_spacing(in);
-	if (!in.read_cur(c)) throw end_of_file();
-	if (c == ']') return list;
+	if (at_end(in)) throw end_of_file();
+	if (*in.cur == ']') {
+		++in.cur;
+		handler.end_list();
+		return;
+	}
 	while (true) {
-		switch (c) {
-			case '"': {
-				std::string val = read_string(in);
-				list.push_back(val);
-				break;
-			}
-			case '{' : {
-				JsonObject val = read_object(in);
-				list.push_back(val);
-				break;
+		parse_value(in, handler);
+		skip_spacing(in);
+		if (at_end(in)) throw end_of_file();
+		if (*in.cur == ']') {
+			++in.cur;
+			handler.end_list();
+			return;
+		}
+		if (*in.cur != ',') {
+			throw unexpected_char(in);
+		}
+		++in.cur;
+		skip_spacing(in);
+	}
+}
+
+template<class Handler>
+void parse_value(JsonParser &in, Handler &handler) {
+	if (at_end(in)) throw end_of_file();
+	switch (*in.cur) {
+		case '"':
+			handler.string_value(read_string_view(in));
+			return;
+		case '{' :
+			if (handler.start_object()) {
+				parse_object(in, handler);
+			} else {
+				skip_value(in);
 			}
-			case '[' : {
-				JsonList val = read_list(in);
-				list.push_back(val);
-				break;
+			return;
+		case '[' :
+			if (handler.start_list()) {
+				parse_list(in, handler);
+			} else {
+				skip_value(in);
 			}
-			case '-':
-			case '0':
-			case '1':
-			case '2':
-			case '3':				
-			case '4':				
-			case '5':				
-			case '6':				
-			case '7':				
-			case '8':				
-			case '9': {
-				int i_val;
-				double d_val;
-				if (read_number(in, i_val, d_val)) {
-					list.push_back(i_val);
-				} else {
-					list.push_back(d_val);
-				}
-				break;
+			return;
+		case '-':
+		case '0':
+		case '1':
+		case '2':
+		case '3':
+		case '4':
+		case '5':
+		case '6':
+		case '7':
+		case '8':
+		case '9': {
+			int i_val;
+			double d_val;
+			if (read_number(in, i_val, d_val)) {
+				handler.int_value(i_val);
+			} else {
+				handler.double_value(d_val);
 			}
-			case 'n': {
-				read_matching(in, "null");
+			return;
+		}
+		case 'n':
+			read_matching(in, "null");
+			handler.null_value();
+			return;
+		case 't':
+			read_matching(in, "true");
+			handler.bool_value(true);
+			return;
+		case 'f':
+			read_matching(in, "false");
+			handler.bool_value(false);
+			return;
+		default:
+			throw unexpected_char(in);
+	}
+}
+
+/**
+ * Handler building a JsonObject. Values are written in place into the object or list they belong to.
+ */
+class DomBuilder {
+	public:
+		bool start_object() {
+			json::Type& slot = next_slot();
+			slot = JsonObject();
+			stack.push_back({&slot, false});
+			return true;
+		}
+
+		void end_object() {
+			stack.pop_back();
+		}
+
+		bool start_list() {
+			json::Type& slot = next_slot();
+			slot = JsonList();
+			stack.push_back({&slot, true});
+			return true;
+		}
+
+		void end_list() {
+			stack.pop_back();
+		}
+
+		bool key(const std::string_view key) {
+			pending = &std::get<JsonObject>(*stack.back().first).get(key);
+			return true;
+		}
+
+		void int_value(const int value) {
+			next_slot() = value;
+		}
+
+		void double_value(const double value) {
+			next_slot() = value;
+		}
+
+		void bool_value(const bool value) {
+			next_slot() = value;
+		}
+
+		void string_value(const std::string_view value) {
+			next_slot() = std::string(value);
+		}
+
+		void null_value() {
+			next_slot() = JsonNull();
+		}
+
+		JsonObject& result() {
+			return std::get<JsonObject>(root);
+		}
+
+	private:
+		/**
+		 * Returns where the next value goes: the root, the end of the innermost list or the last key read.
+		 */
+		json::Type& next_slot() {
+			if (stack.empty()) return root;
+			if (stack.back().second) {
+				JsonList& list = std::get<JsonList>(*stack.back().first);
 				list.push_back(JsonNull());
-				break;
-			}
-			case 't': {
-				read_matching(in, "true");
-				list.push_back<bool>(true);
-				
-				break;
+				return list.get(static_cast<unsigned>(list.size() - 1));
 			}
-			case 'f': {
-				read_matching(in, "false");
-				list.push_back<bool>(false);
-				break;
-			}
-			default:
-				throw unexpected_char(c, in);
+			return *pending;
 		}
-		skip_spacing(in);
-		if (!in.read_cur(c)) throw end_of_file();
-		if (c == ']') return list;
-		else if (c != ',') {
-			throw unexpected_char(c, in);
+
+		json::Type root;
+		// Open objects and lists, with true for lists.
+		std::vector<std::pair<json::Type*, bool>> stack;
+		json::Type* pending = nullptr;
+};
+
+/**
+ * Reads a document that must be an object into a JsonObject.
+ */
+/**
+ * Throws unless only whitespace is left after the root value.
+ */
+void expect_end(JsonParser &in) {
+	skip_spacing(in);
+	if (!at_end(in)) throw unexpected_char(in);
+}
+
+JsonObject read_document(JsonParser &in) {
+	skip_spacing(in);
+	if (at_end(in)) throw end_of_file();
+	if (*in.cur != '{') throw expected_char('{', in);
+	DomBuilder builder;
+	parse_value(in, builder);
+	expect_end(in);
+	return std::move(builder.result());
+}
+
+JsonObject json::read_from_file(const std::string& path) {
+	PROFILE_ZONE("json::read_from_file");
+	size_t size = 0;
+	std::unique_ptr<char, SDLFreeDeleter> data(static_cast<char*>(SDL_LoadFile(path.c_str(), &size)));
+	if (data == nullptr) {
+		throw file_exception("File exception: " + std::string(SDL_GetError()));
+	}
+	return read_from_buffer(data.get(), size);
+}
+
+JsonObject json::read_from_buffer(const char* data, const size_t size) {
+	JsonParser parser = {data, data, data + size, nullptr, nullptr, {}, 1, 1, {}};
+	return read_document(parser);
+}
+
+void json::read_events(const std::string& path, JsonHandler& handler) {
+	std::unique_ptr<SDL_RWops, RWopsDeleter> source(SDL_RWFromFile(path.c_str(), "rb"));
+	if (source == nullptr) {
+		throw file_exception("File exception: " + std::string(SDL_GetError()));
+	}
+	JsonParser parser = {nullptr, nullptr, nullptr, nullptr, source.get(), std::vector<char>(STREAM_BUFFER_SIZE), 1, 1, {}};
+	parser.begin = parser.cur = parser.end = parser.buffer.data();
+	skip_spacing(parser);
+	parse_value(parser, handler);
+	expect_end(parser);
+}
+
+void json::read_events(const char* data, const size_t size, JsonHandler& handler) {
+	JsonParser parser = {data, data, data + size, nullptr, nullptr, {}, 1, 1, {}};
+	skip_spacing(parser);
+	parse_value(parser, handler);
+	expect_end(parser);
+}
+
+/**
+ * Interned keys by content. Entries are views into the strings they map to, and are removed by the deleter
+ * of those strings, so the pool only holds keys some object still uses.
+ */
+struct KeyPool {
+	std::mutex mutex;
+	std::unordered_map<std::string_view, std::weak_ptr<const std::string>> keys;
+};
+
+static KeyPool& key_pool() {
+	// Never destroyed, as keys of static objects are released after it would be.
+	static KeyPool* pool = new KeyPool();
+	return *pool;
+}
+
+static void release_key(const std::string* key) {
+	KeyPool& pool = key_pool();
+	{
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		const auto el = pool.keys.find(*key);
+		// The entry may already hold a newer copy of the key, made after this one expired.
+		if (el != pool.keys.end() && el->second.expired() && el->first.data() == key->data()) {
+			pool.keys.erase(el);
 		}
-		skip_spacing(in);
-		if (!in.read_cur(c)) throw end_of_file();
 	}
+	delete key;
 }
 
-std::string read_string(FileReader &in) {
-	char c;
-	validate_char(in, '"');
-	std::string res;
-	while (in.read_next(c)) {
-		if (c == '\\') {
-			if (!in.read_next(c)) throw end_of_file();
-			if (c == '\\' || c == '"' || c == '/') {
-				res.push_back(c);
-			} else if (c == 'n') {
-				res.push_back('\n');
-			} else if (c == 't') {
-				res.push_back('\t');
-			} else if (c == 'b') {
-				res.push_back('\b');
-			} else if (c == 'f') {
-				res.push_back('\f');
-			} else if (c == 'r') {
-				res.push_back('\r');
-			} else {
-				throw json_exception("Unsupported escape character: \\" + std::string(1, c));
-			}
-		} else if (c == '"') {
-			return res;
-		} else {
-			res.push_back(c);
+std::shared_ptr<const std::string> json::intern_key(const std::string_view key, const uint64_t hash) {
+	if (key.size() > MAX_INTERNED_KEY) {
+		return std::make_shared<const std::string>(key);
+	}
+	// Recently interned keys of this thread, so parsing repeated keys does not contend on the pool.
+	constexpr size_t RECENT_KEYS = 256;
+	thread_local std::weak_ptr<const std::string> recent[RECENT_KEYS];
+	std::weak_ptr<const std::string>& slot = recent[hash & (RECENT_KEYS - 1)];
+	if (std::shared_ptr<const std::string> s = slot.lock(); s != nullptr && *s == key) {
+		return s;
+	}
+
+	KeyPool& pool = key_pool();
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	const auto el = pool.keys.find(key);
+	if (el != pool.keys.end()) {
+		if (std::shared_ptr<const std::string> s = el->second.lock()) {
+			slot = s;
+			return s;
 		}
+		// Expired, but its deleter has not removed it yet.
+		pool.keys.erase(el);
 	}
-	throw end_of_file();
-} 
+	std::shared_ptr<const std::string> s(new std::string(key), release_key);
+	pool.keys.emplace(*s, s);
+	slot = s;
+	return s;
+}
 
+json::Type& JsonObject::find_or_insert(const JsonKey& key) {
+	if (Entry* el = find(key)) {
+		return el->value;
+	}
+	entries.push_back({json::intern_key(key.name(), key.hash()), key.hash(), json::Type()});
+	if (entries.size() * 2 > index.size()) {
+		if (entries.size() > INDEX_THRESHOLD) {
+			rebuild_index(index.empty() ? INDEX_THRESHOLD * 4 : index.size() * 2);
+		}
+	} else {
+		const size_t mask = index.size() - 1;
+		size_t i = key.hash() & mask;
+		while (index[i] != 0) i = (i + 1) & mask;
+		index[i] = static_cast<uint32_t>(entries.size());
+	}
+	return entries.back().value;
+}
 
-void skip_spacing(FileReader &in) {
-	char c;
-	while (in.read_next(c)) {
-		if (c != ' ' && c != '\n' && c != '\r' && c != '\t') return;
+void JsonObject::rebuild_index(const size_t size) {
+	index.assign(size, 0);
+	const size_t mask = size - 1;
+	for (size_t e = 0; e < entries.size(); ++e) {
+		size_t i = entries[e].hash & mask;
+		while (index[i] != 0) i = (i + 1) & mask;
+		index[i] = static_cast<uint32_t>(e + 1);
 	}
 }
 
-JsonObject json::read_from_file(const std::string& path) {
-	FileReader reader(path, false);
-	skip_spacing(reader);
-	return read_object(reader);
+/**
+ * Writer output to a std::ostream.
+ */
+class StreamSink {
+	public:
+		explicit StreamSink(std::ostream& os) : os(os) {};
+
+		void write(const char* s, const size_t len) {
+			os.write(s, static_cast<std::streamsize>(len));
+		}
+
+		void write(const char c) {
+			os.put(c);
+		}
+
+	private:
+		std::ostream& os;
+};
+
+/**
+ * Writer output to a FileWriter, remembering if any write failed.
+ */
+class FileSink {
+	public:
+		explicit FileSink(FileWriter& writer) : writer(writer) {};
+
+		void write(const char* s, const size_t len) {
+			ok = writer.write_many(s, static_cast<int>(len)) && ok;
+		}
+
+		void write(const char c) {
+			ok = writer.write(c) && ok;
+		}
+
+		bool ok = true;
+
+	private:
+		FileWriter& writer;
+};
+
+template<class Sink>
+void write_indentation(Sink &out, int indentations) {
+	static const char TABS[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+	constexpr int TAB_COUNT = sizeof(TABS) - 1;
+	for (; indentations > TAB_COUNT; indentations -= TAB_COUNT) {
+		out.write(TABS, TAB_COUNT);
+	}
+	out.write(TABS, indentations);
 }
 
-void json::to_pretty_stream(std::ostream& os, const json::Type& val) {
-	to_pretty_stream(os, val, 0);
+template<class Sink>
+void write_number(Sink &out, const int i) {
+	char buf[16];
+	const auto res = std::to_chars(buf, buf + sizeof(buf), i);
+	out.write(buf, res.ptr - buf);
 }
 
-void json::escape_string_to_stream(std::ostream& os, const std::string& s) {
-	os << '"';
-	for (char c : s) {
-		switch (c) {
-			case '\\':
-				os << "\\\\";
-				break;
-			case '\"':
-				os << "\\\"";
-				break;
-			case '\n':
-				os << "\\n";
-				break;
-			case '\t':
-				os << "\\t";
-				break;
-			case '\b':
-				os << "\\b";
-				break;
-			case '\f':
-				os << "\\f";
-			case '\r':
-				os << "\\r";
-				break;
-			default:
-				os << c;
+template<class Sink>
+void write_number(Sink &out, const double d) {
+	if (!std::isfinite(d)) {
+		// Json has no representation of infinity or NaN.
+		out.write("null", 4);
+		return;
+	}
+	// Shortest form that reads back to the same double.
+	char buf[32];
+	char* end = std::to_chars(buf, buf + sizeof(buf) - 2, d).ptr;
+	if (std::find_if(buf, end, [](char c) {return c == '.' || c == 'e';}) == end) {
+		// Keep a fraction, so that the value is read back as a double and not an int.
+		*end++ = '.';
+		*end++ = '0';
+	}
+	out.write(buf, end - buf);
+}
+
+/**
+ * Returns the escape sequence for c, or nullptr if c is written as is.
+ */
+const char* escape_sequence(const char c) {
+	switch (c) {
+		case '\\':
+			return "\\\\";
+		case '\"':
+			return "\\\"";
+		case '\n':
+			return "\\n";
+		case '\t':
+			return "\\t";
+		case '\b':
+			return "\\b";
+		case '\f':
+			return "\\f";
+		case '\r':
+			return "\\r";
+		default:
+			return nullptr;
+	}
+}
+
+template<class Sink>
+void write_escaped(Sink &out, const std::string_view s) {
+	out.write('"');
+	// Write runs of characters that need no escaping in one go.
+	const char* run = s.data();
+	const char* end = s.data() + s.size();
+	for (const char* c = run; c != end; ++c) {
+		const char* escape = escape_sequence(*c);
+		if (escape == nullptr) continue;
+		out.write(run, c - run);
+		out.write(escape, 2);
+		run = c + 1;
+	}
+	out.write(run, end - run);
+	out.write('"');
+}
+
+template<class Sink>
+void write_value(Sink &out, const json::Type& val, int indentations, bool pretty);
+
+template<class Sink>
+void write_object(Sink &out, const JsonObject& obj, const int indentations, const bool pretty) {
+	out.write('{');
+	if (obj.size() == 0) {
+		out.write('}');
+		return;
+	}
+	if (pretty) out.write('\n');
+	for (auto it = obj.begin(); it != obj.end(); ++it) {
+		if (it != obj.begin()) {
+			if (pretty) out.write(",\n", 2);
+			else out.write(',');
 		}
+		if (pretty) write_indentation(out, indentations + 1);
+		write_escaped(out, *it->key);
+		if (pretty) out.write(" : ", 3);
+		else out.write(':');
+		write_value(out, it->value, indentations + 1, pretty);
 	}
-	os << '"';
+	if (pretty) {
+		out.write('\n');
+		write_indentation(out, indentations);
+	}
+	out.write('}');
 }
 
-void json::to_stream(std::ostream& os, const json::Type& val) {
+template<class Sink>
+void write_list(Sink &out, const JsonList& list, const int indentations, const bool pretty) {
+	out.write('[');
+	if (list.size() == 0) {
+		out.write(']');
+		return;
+	}
+	if (pretty) out.write('\n');
+	for (auto it = list.begin(); it != list.end(); ++it) {
+		if (it != list.begin()) {
+			if (pretty) out.write(",\n", 2);
+			else out.write(',');
+		}
+		if (pretty) write_indentation(out, indentations + 1);
+		write_value(out, *it, indentations + 1, pretty);
+	}
+	if (pretty) {
+		out.write('\n');
+		write_indentation(out, indentations);
+	}
+	out.write(']');
+}
+
+template<class Sink>
+void write_value(Sink &out, const json::Type& val, const int indentations, const bool pretty) {
 	if (const JsonObject *obj = std::get_if<JsonObject>(&val)) {
-		obj->to_stream(os);
+		write_object(out, *obj, indentations, pretty);
 	} else if (const JsonList *list = std::get_if<JsonList>(&val)) {
-		list->to_stream(os);
-	} else if (const JsonNull *null_obj = std::get_if<JsonNull>(&val)) {
-		os << "null";
+		write_list(out, *list, indentations, pretty);
+	} else if (std::holds_alternative<JsonNull>(val)) {
+		out.write("null", 4);
 	} else if (const int* i = std::get_if<int>(&val)) {
-		os << *i;
+		write_number(out, *i);
 	} else if (const double* d = std::get_if<double>(&val)) {
-		os << *d;
+		write_number(out, *d);
 	} else if (const bool* b = std::get_if<bool>(&val)) {
-		if (*b) os << "true";
-		else os << "false";
+		if (*b) out.write("true", 4);
+		else out.write("false", 5);
 	} else if (const std::string *s = std::get_if<std::string>(&val)) {
-		json::escape_string_to_stream(os, *s);
+		write_escaped(out, *s);
 	}
 }
 
+void json::to_pretty_stream(std::ostream& os, const json::Type& val) {
+	StreamSink out(os);
+	write_value(out, val, 0, true);
+}
+
+void json::escape_string_to_stream(std::ostream& os, const std::string& s) {
+	StreamSink out(os);
+	write_escaped(out, s);
+}
+
+void json::to_stream(std::ostream& os, const json::Type& val) {
+	StreamSink out(os);
+	write_value(out, val, 0, false);
+}
 
 void json::write_to_file(std::string path, const JsonObject &obj) {
 	write_to_file(std::move(path), obj, true);
@@ -403,97 +929,44 @@ void json::write_to_file(std::string path, const JsonObject &obj) {
 
 void json::write_to_file(const std::string& path, const JsonObject &obj, bool pretty) {
 	FileWriter writer(path, false);
-	std::stringstream s;
-	if (pretty) {
-		s << obj;
-	} else {
-		obj.to_stream(s);
-	}
-	std::string str = s.str();
-	writer.write(str);
-}
-
-void to_pretty_stream(std::ostream& os, const json::Type& val, int indentations) {
-	if (const JsonObject *obj = std::get_if<JsonObject>(&val)) {
-		obj->to_pretty_stream(os, indentations);
-	} else if (const JsonList *list = std::get_if<JsonList>(&val)) {
-		list->to_pretty_stream(os, indentations);
-	} else if (const JsonNull *null_obj = std::get_if<JsonNull>(&val)) {
-		os << "null";
-	} else if (const int* i = std::get_if<int>(&val)) {
-		os << *i;
-	} else if (const double* d = std::get_if<double>(&val)) {
-		os << *d;
-	} else if (const bool* b = std::get_if<bool>(&val)) {
-		if (*b) os << "true";
-		else os << "false";
-	} else if (const std::string *s = std::get_if<std::string>(&val)) {
-		json::escape_string_to_stream(os, *s);
+	FileSink out(writer);
+	write_object(out, obj, 0, pretty);
+	if (!writer.flush() || !out.ok) {
+		throw file_exception("Could not write to file, " + std::string(SDL_GetError()));
 	}
 }
 
 void JsonObject::to_pretty_stream(std::ostream& os, int indentations) const {
-	os << '{';
-	if (data.empty()) {
-		os << '}';
-		return;
-	}
-	os << '\n';
-	
-	for (auto it = keys.cbegin(); it != keys.cend(); ++it) {
-		if (it != keys.begin()) os << ",\n";
-		for (int i = 0; i < indentations + 1; i++) {
-			os << '\t';
-		}
-		os << "\"" << *it << "\" : ";
-		const json::Type& val = data.at(*it);
-		::to_pretty_stream(os, val, indentations + 1);
-	}
-	os << '\n';
-	for (int i = 0; i < indentations; i++) os << '\t';
-	os << '}';
+	StreamSink out(os);
+	write_object(out, *this, indentations, true);
 }
 
 void JsonObject::to_stream(std::ostream& os) const {
-	os << '{';
-	for (auto it = keys.begin(); it != keys.end(); ++it) {
-		if (it != keys.begin()) os << ',';
-		os << '"' << *it << "\":";
-		const json::Type& val = data.at(*it);
-		json::to_stream(os, val);
-	}
-	os << '}';
+	StreamSink out(os);
+	write_object(out, *this, 0, false);
 }
 
 void JsonList::to_pretty_stream(std::ostream& os, int indentations) const {
-	os << '[';
-	if (data.empty()) {
-		os << ']';
-		return;
-	}
-	os << '\n';
-	
-	for (auto it = data.begin(); it != data.end(); ++it) {
-		if (it != data.begin()) os << ",\n";
-		for (int i = 0; i < indentations + 1; i++) {
-			os << '\t';
-		}
-		const json::Type &val = *it;
-		::to_pretty_stream(os, val, indentations + 1);
-	}
-	os << '\n';
-	for (int i = 0; i < indentations; i++) os << '\t';
-	os << ']';
+	StreamSink out(os);
+	write_list(out, *this, indentations, true);
 }
 
 void JsonList::to_stream(std::ostream& os) const {
-	os << '[';
-	for (auto it = data.begin(); it != data.end(); ++it) {
-		if (it != data.begin()) os << ',';
-		const json::Type &val = *it;
-		json::to_stream(os, val);
+	StreamSink out(os);
+	write_list(out, *this, 0, false);
+}
+
+bool operator==(const JsonObject &a, const JsonObject &b) {
+	if (a.size() != b.size()) return false;
+	for (const JsonObject::Entry& entry : a) {
+		const json::Type* other = b.find_value(*entry.key);
+		if (other == nullptr || *other != entry.value) return false;
 	}
-	os << ']';
+	return true;
+}
+
+bool operator==(const JsonList &a, const JsonList &b) {
+	return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
 }
 
 std::ostream& operator<<(std::ostream& os, const JsonObject &obj) {
@@ -504,4 +977,4 @@ std::ostream& operator<<(std::ostream& os, const JsonObject &obj) {
 std::ostream& operator<<(std::ostream& os, const JsonList &list) {
 	list.to_pretty_stream(os, 0);
 	return os;
-}
\ No newline at end of file
+}
@@ -1,10 +1,12 @@
 #ifndef JSON_00_H
 #define JSON_00_H
+#include <memory>
 #include <utility>
 #include <vector>
-#include <list>
+#include <cstdint>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <variant>
 #include <iostream>
 #include "util/exceptions.h"
@@ -23,15 +25,61 @@ class JsonList;
 
 class JsonNull {};
 
+inline bool operator==(const JsonNull&, const JsonNull&) {
+	return true;
+}
+
+inline bool operator!=(const JsonNull&, const JsonNull&) {
+	return false;
+}
+
+class JsonHandler;
+
 namespace json {
 
 	typedef std::variant<JsonObject, JsonList, int, double, bool, std::string, JsonNull> Type;
 
 	/**
-	 * Reads a JsonObject from a file.
+	 * Returns the shared copy of key, where hash is hash_key(key). A key is freed with the last object using it,
+	 * and keys longer than MAX_INTERNED_KEY get a copy of their own.
+	 */
+	std::shared_ptr<const std::string> intern_key(std::string_view key, uint64_t hash);
+
+	constexpr size_t MAX_INTERNED_KEY = 64;
+
+	/**
+	 * 64 bit FNV-1a hash of key, used for looking up keys in a JsonObject.
+	 */
+	constexpr uint64_t hash_key(const std::string_view key) {
+		uint64_t h = 0xCBF29CE484222325ull;
+		for (const char c : key) {
+			h ^= static_cast<unsigned char>(c);
+			h *= 0x100000001B3ull;
+		}
+		return h;
+	}
+
+	/**
+	 * Reads a JsonObject from a file. Anything but whitespace after the object is an error.
 	 */
 	JsonObject read_from_file(const std::string& path);
 
+	/**
+	 * Reads a JsonObject from the first size characters of data.
+	 */
+	JsonObject read_from_buffer(const char* data, size_t size);
+
+	/**
+	 * Reads the json value in a file, reporting it to handler as it is read instead of building a JsonObject.
+	 * The file is read through a small window, so memory use does not depend on the size of the file.
+	 */
+	void read_events(const std::string& path, JsonHandler& handler);
+
+	/**
+	 * Reads the json value in the first size characters of data, reporting it to handler.
+	 */
+	void read_events(const char* data, size_t size, JsonHandler& handler);
+
 	/**
 	 * Writes a JsonObject to a file, in prettified form with indentations and newlines.
 	 */
@@ -60,136 +108,181 @@ namespace json {
 	void escape_string_to_stream(std::ostream& os, const std::string& s);
 }
 
+/**
+ * A key for looking up values in a JsonObject, with its hash computed once.
+ * A constexpr JsonKey made from a literal is hashed at compile time. Only views the key, so it must not outlive it.
+ */
+class JsonKey {
+	public:
+		constexpr JsonKey(const char* key) : JsonKey(std::string_view(key)) {};
+		constexpr JsonKey(const std::string_view key) : key(key), hash_value(json::hash_key(key)) {};
+		JsonKey(const std::string& key) : JsonKey(std::string_view(key)) {};
+
+		[[nodiscard]] constexpr std::string_view name() const {
+			return key;
+		}
+
+		[[nodiscard]] constexpr uint64_t hash() const {
+			return hash_value;
+		}
+
+	private:
+		std::string_view key;
+		uint64_t hash_value;
+};
+
+/**
+ * Receives the values of a json document from json::read_events, in the order they appear.
+ * Strings passed to key and string_value are only valid during the call.
+ * Returning false from start_object or start_list skips that object or list without reading its contents,
+ * and end_object or end_list is then not called. Returning false from key skips the value of that key.
+ * Skipped values are only checked for balanced brackets.
+ */
+class JsonHandler {
+	public:
+		virtual ~JsonHandler() = default;
+
+		virtual bool start_object() {return true;}
+
+		virtual void end_object() {}
+
+		virtual bool start_list() {return true;}
+
+		virtual void end_list() {}
+
+		virtual bool key(std::string_view key) {return true;}
+
+		virtual void int_value(int value) {}
+
+		virtual void double_value(double value) {}
+
+		virtual void bool_value(bool value) {}
+
+		virtual void string_value(std::string_view value) {}
+
+		virtual void null_value() {}
+};
+
 /**
  * Class for representing a Json object.
+ * Entries are kept in a flat vector in insertion order, with keys interned by json::intern_key.
+ * Adding a key may move the other values, so references into an object are invalidated by set on a new key.
+ * Keys are looked up through JsonKey, which can be made from a string or a string literal without allocating.
  */
 class JsonObject {
 	public:
+		struct Entry;
+
+		/**
+		 * Iterator over the keys of an object, in insertion order.
+		 */
+		class KeyIterator {
+			public:
+				explicit KeyIterator(std::vector<Entry>::const_iterator it) : it(it) {};
+
+				const std::string& operator*() const;
+				const std::string* operator->() const;
+
+				KeyIterator& operator++();
+
+				bool operator==(const KeyIterator& other) const {
+					return it == other.it;
+				}
+				bool operator!=(const KeyIterator& other) const {
+					return it != other.it;
+				}
+
+			private:
+				std::vector<Entry>::const_iterator it;
+		};
 
 		/**
 		 * Gets a value of type T with key key from the object.
 		 */
 		template<class T>
-		T& get(const std::string& key) {
-			return std::get<T>(data[key]);
-		}
+		T& get(const JsonKey& key);
 		template<class T>
-		const T& get(const std::string& key) const {
-			return std::get<T>(data.at(key));
-		}
+		const T& get(const JsonKey& key) const;
 
 		/**
 		 * Gets a value of type T with key key from the object.
 		 * If no such value exists, default_val is returned.
 		 */
 		template<class T>
-		const T &get_default(const std::string& key, const T& default_val) const {
-			const auto& el = data.find(key);
-			if (el == data.end()) return default_val;
-			const json::Type &var = el->second;
-			if (!std::holds_alternative<T>(var)) {
-				return default_val;
-			}
-			return std::get<T>(var);
-		}
+		const T &get_default(const JsonKey& key, const T& default_val) const;
 		template<class T>
-		T& get_default(const std::string& key, T& default_val) {
-			const auto& el = data.find(key);
-			if (el == data.end()) return default_val;
-			json::Type &var = el->second;
-			if (!std::holds_alternative<T>(var)) {
-				return default_val;
-			}
-			return std::get<T>(var);
-		}
+		T& get_default(const JsonKey& key, T& default_val);
 
 		/**
 		 * Gets a json::Type with key key from the object.
+		 * The const version throws std::out_of_range if there is no such key,
+		 * the other one inserts a default constructed value.
 		 */
-		[[nodiscard]] const json::Type& get(const std::string& key) const {
-			return data.at(key);
-		}
-		json::Type& get(const std::string& key) {
-			return data[key];
-		}
+		[[nodiscard]] const json::Type& get(const JsonKey& key) const;
+		json::Type& get(const JsonKey& key);
+
+		/**
+		 * Returns the value with key key, or nullptr if there is none.
+		 */
+		[[nodiscard]] const json::Type* find_value(const JsonKey& key) const;
 
 		/**
 		 * Sets the value at key to value.
 		 */
 		template<class T>
-		void set(const std::string& key, const T& value) {
-			if (!has_key(key)) keys.push_back(key);
-			data[key] = value;
-		}
+		void set(const JsonKey& key, const T& value);
+		template<class T>
+		void set(const JsonKey& key, T&& value);
 
 		/**
-		 * Gets a beginning iterator to the underlying map. No iteration order is guaranteed.
+		 * Gets a beginning iterator to the entries, in insertion order.
 		 */
-		std::unordered_map<std::string, json::Type>::iterator begin() {
-			return data.begin();
-		}
-		[[nodiscard]] std::unordered_map<std::string, json::Type>::const_iterator begin() const {
-			return data.begin();
-		}
+		std::vector<Entry>::iterator begin();
+		[[nodiscard]] std::vector<Entry>::const_iterator begin() const;
 
 		/**
-		 * Gets an end iterator to the underlying map.
+		 * Gets an end iterator to the entries.
 		 */
-		std::unordered_map<std::string, json::Type>::iterator end() {
-			return data.end();
-		}
-		[[nodiscard]] std::unordered_map<std::string, json::Type>::const_iterator end() const {
-			return data.end();
-		}
+		std::vector<Entry>::iterator end();
+		[[nodiscard]] std::vector<Entry>::const_iterator end() const;
 
 		/**
 		 * Gets an beginning iterator to the keys of this object.
 		 * The order of iteration is the order of insertion.
 		 */
-		[[nodiscard]] std::list<std::string>::const_iterator keys_begin() const {
-			return keys.begin();
-		}
+		[[nodiscard]] KeyIterator keys_begin() const;
 
 		/**
 		 * Gets an end iterator to the keys of this object.
 		 */
-		[[nodiscard]] std::list<std::string>::const_iterator keys_end() const {
-			return keys.end();
-		}
+		[[nodiscard]] KeyIterator keys_end() const;
 
 		/**
 		 * Returns true if this object contains the key key.
 		 */
-		[[nodiscard]] bool has_key(const std::string& key) const {
-			return data.count(key) != 0;
-		}
+		[[nodiscard]] bool has_key(const JsonKey& key) const;
 
 		/**
 		 * Returns true if this object contains the key key,
 		 *	and the value at key has the type T.
 		 */
 		template<class T>
-		[[nodiscard]] bool has_key_of_type(const std::string& key) const {
-			const auto& el = data.find(key);
-			if (el == data.end()) return false;
-			const json::Type& val = el->second;
-			return std::get_if<T>(&val) != nullptr;
-		}
+		[[nodiscard]] bool has_key_of_type(const JsonKey& key) const;
 
 		/**
 		 * Returns the number of elements in this object.
 		 */
-		[[nodiscard]] size_t size() const {
-			return data.size();
-		}
+		[[nodiscard]] size_t size() const;
 
 		/**
 		 * Removes all elements from this object.
 		 */
-		void clear() {
-			data.clear();
-			keys.clear();
-		}
+		void clear();
+
+		/**
+		 * Reserves space for count elements.
+		 */
+		void reserve(size_t count);
 
 		/**
 		 * Outputs this object as text to a stream, using indentations and spaces.
@@ -204,9 +297,30 @@ class JsonObject {
 		void to_stream(std::ostream& os) const;
 	
 	private:
-		std::unordered_map<std::string, json::Type> data;
+		/**
+		 * Returns the entry with key key, or nullptr if there is none.
+		 */
+		[[nodiscard]] const Entry* find(const JsonKey& key) const;
+		Entry* find(const JsonKey& key);
+
+		/**
+		 * Returns the value at key, appending a default constructed entry if there is none.
+		 */
+		json::Type& find_or_insert(const JsonKey& key);
+
+		/**
+		 * Rebuilds index with size slots.
+		 */
+		void rebuild_index(size_t size);
+
+		// Objects with more entries than this get a hash index, smaller ones are searched linearly.
+		static constexpr size_t INDEX_THRESHOLD = 16;
+
+		std::vector<Entry> entries;
 
-		std::list<std::string> keys;
+		// Open addressed table of positions in entries plus one, 0 marks an empty slot.
+		// Only built for objects larger than INDEX_THRESHOLD, and kept at most half full.
+		std::vector<uint32_t> index;
 };
 
 /**
@@ -219,83 +333,62 @@ class JsonList {
 		 * Returns true if this list has an entry at index with type T.
 		 */
 		template<class T>
-		[[nodiscard]] bool has_index_of_type(const unsigned index) const {
-			if (index >= data.size()) return false;
-			const json::Type& t = data[index];
-			return std::get_if<T>(&t) != nullptr;
-		}
+		[[nodiscard]] bool has_index_of_type(const unsigned index) const;
 
 		/**
 		 * Gets the element of type T at index from this list.
 		 */
 		template<class T>
-		T& get(const unsigned index) {
-			return std::get<T>(data[index]);
-		}
+		T& get(const unsigned index);
 		template<class T>
-		const T& get(const unsigned index) const {
-			return std::get<T>(data[index]);
-		}
+		const T& get(const unsigned index) const;
 
 		/**
 		 * Gets the json::Type at index from this list.
 		 */
-		json::Type& get(const unsigned index) {
-			return data[index];
-		}
-		[[nodiscard]] const json::Type& get(const unsigned index) const {
-			return data[index];
-		}
+		json::Type& get(unsigned index);
+		[[nodiscard]] const json::Type& get(unsigned index) const;
 
 		/**
 		 * Sets the entry at index to value.
 		 */
 		template<class T>
-		void set(const unsigned index, const T& value) {
-			data[index] = value;
-		}
+		void set(const unsigned index, const T& value);
 
 		/**
 		 * Append an element of type T to the end of the list.
 		 */
 		template<class T>
-		void push_back(const T& value) {
-			data.emplace_back(value);
-		}
+		void push_back(const T& value);
+		template<class T>
+		void push_back(T&& value);
 
 		/**
 		 * Gets an iterator to the beginning of the list.
 		 */
-		std::vector<json::Type>::iterator begin() {
-			return data.begin();
-		}
-		[[nodiscard]] std::vector<json::Type>::const_iterator begin() const {
-			return data.begin();
-		}
+		std::vector<json::Type>::iterator begin();
+		[[nodiscard]] std::vector<json::Type>::const_iterator begin() const;
 
 		/**
 		 * Gets an iterator to the end of the list.
 		 */
-		std::vector<json::Type>::iterator end() {
-			return data.end();
-		}
-		[[nodiscard]] std::vector<json::Type>::const_iterator end() const {
-			return data.end();
-		}
+		std::vector<json::Type>::iterator end();
+		[[nodiscard]] std::vector<json::Type>::const_iterator end() const;
 
 		/**
 		 * Returns the number of entries in the list.
 		 */
-		[[nodiscard]] size_t size() const {
-			return data.size();
-		}
+		[[nodiscard]] size_t size() const;
 
 		/**
 		 * Removes all entries from the list.
 		 */
-		void clear() {
-			data.clear();
-		}
+		void clear();
+
+		/**
+		 * Reserves space for count entries.
+		 */
+		void reserve(size_t count);
 
 		/**
 		 * Outputs this list as a string to a stream, using indentations and spaces.
@@ -311,6 +404,239 @@ class JsonList {
 		std::vector<json::Type> data;
 		
 };
+
+/*
+ * Members using json::Type are defined here, where both JsonObject and JsonList are complete.
+ */
+struct JsonObject::Entry {
+	std::shared_ptr<const std::string> key;
+	uint64_t hash;
+	json::Type value;
+};
+
+template<class T>
+T& JsonObject::get(const JsonKey& key) {
+	return std::get<T>(find_or_insert(key));
+}
+
+template<class T>
+const T& JsonObject::get(const JsonKey& key) const {
+	return std::get<T>(get(key));
+}
+
+template<class T>
+const T& JsonObject::get_default(const JsonKey& key, const T& default_val) const {
+	const Entry* el = find(key);
+	if (el == nullptr || !std::holds_alternative<T>(el->value)) {
+		return default_val;
+	}
+	return std::get<T>(el->value);
+}
+
+template<class T>
+T& JsonObject::get_default(const JsonKey& key, T& default_val) {
+	Entry* el = find(key);
+	if (el == nullptr || !std::holds_alternative<T>(el->value)) {
+		return default_val;
+	}
+	return std::get<T>(el->value);
+}
+
+template<class T>
+void JsonObject::set(const JsonKey& key, const T& value) {
+	// Built first, value might refer into entries, which inserting can move.
+	json::Type val(value);
+	find_or_insert(key) = std::move(val);
+}
+
+template<class T>
+void JsonObject::set(const JsonKey& key, T&& value) {
+	json::Type val(std::forward<T>(value));
+	find_or_insert(key) = std::move(val);
+}
+
+template<class T>
+bool JsonObject::has_key_of_type(const JsonKey& key) const {
+	const Entry* el = find(key);
+	return el != nullptr && std::holds_alternative<T>(el->value);
+}
+
+inline const std::string& JsonObject::KeyIterator::operator*() const {
+	return *it->key;
+}
+
+inline const std::string* JsonObject::KeyIterator::operator->() const {
+	return it->key.get();
+}
+
+inline JsonObject::KeyIterator& JsonObject::KeyIterator::operator++() {
+	++it;
+	return *this;
+}
+
+inline const JsonObject::Entry* JsonObject::find(const JsonKey& key) const {
+	if (!index.empty()) {
+		const size_t mask = index.size() - 1;
+		for (size_t i = key.hash() & mask; index[i] != 0; i = (i + 1) & mask) {
+			const Entry& entry = entries[index[i] - 1];
+			if (entry.hash == key.hash() && *entry.key == key.name()) return &entry;
+		}
+		return nullptr;
+	}
+	for (const Entry& entry : entries) {
+		if (entry.hash == key.hash() && *entry.key == key.name()) return &entry;
+	}
+	return nullptr;
+}
+
+inline JsonObject::Entry* JsonObject::find(const JsonKey& key) {
+	return const_cast<Entry*>(static_cast<const JsonObject*>(this)->find(key));
+}
+
+inline const json::Type& JsonObject::get(const JsonKey& key) const {
+	const Entry* el = find(key);
+	if (el == nullptr) {
+		throw std::out_of_range("No json value with key " + std::string(key.name()));
+	}
+	return el->value;
+}
+
+inline json::Type& JsonObject::get(const JsonKey& key) {
+	return find_or_insert(key);
+}
+
+inline const json::Type* JsonObject::find_value(const JsonKey& key) const {
+	const Entry* el = find(key);
+	return el == nullptr ? nullptr : &el->value;
+}
+
+inline std::vector<JsonObject::Entry>::iterator JsonObject::begin() {
+	return entries.begin();
+}
+
+inline std::vector<JsonObject::Entry>::const_iterator JsonObject::begin() const {
+	return entries.begin();
+}
+
+inline std::vector<JsonObject::Entry>::iterator JsonObject::end() {
+	return entries.end();
+}
+
+inline std::vector<JsonObject::Entry>::const_iterator JsonObject::end() const {
+	return entries.end();
+}
+
+inline JsonObject::KeyIterator JsonObject::keys_begin() const {
+	return KeyIterator(entries.begin());
+}
+
+inline JsonObject::KeyIterator JsonObject::keys_end() const {
+	return KeyIterator(entries.end());
+}
+
+inline bool JsonObject::has_key(const JsonKey& key) const {
+	return find(key) != nullptr;
+}
+
+inline size_t JsonObject::size() const {
+	return entries.size();
+}
+
+inline void JsonObject::clear() {
+	entries.clear();
+	index.clear();
+}
+
+inline void JsonObject::reserve(const size_t count) {
+	entries.reserve(count);
+}
+
+template<class T>
+bool JsonList::has_index_of_type(const unsigned index) const {
+	if (index >= data.size()) return false;
+	const json::Type& t = data[index];
+	return std::get_if<T>(&t) != nullptr;
+}
+
+template<class T>
+T& JsonList::get(const unsigned index) {
+	return std::get<T>(data[index]);
+}
+
+template<class T>
+const T& JsonList::get(const unsigned index) const {
+	return std::get<T>(data[index]);
+}
+
+template<class T>
+void JsonList::set(const unsigned index, const T& value) {
+	data[index] = value;
+}
+
+template<class T>
+void JsonList::push_back(const T& value) {
+	data.emplace_back(value);
+}
+
+template<class T>
+void JsonList::push_back(T&& value) {
+	data.emplace_back(std::forward<T>(value));
+}
+
+inline json::Type& JsonList::get(const unsigned index) {
+	return data[index];
+}
+
+inline const json::Type& JsonList::get(const unsigned index) const {
+	return data[index];
+}
+
+inline std::vector<json::Type>::iterator JsonList::begin() {
+	return data.begin();
+}
+
+inline std::vector<json::Type>::const_iterator JsonList::begin() const {
+	return data.begin();
+}
+
+inline std::vector<json::Type>::iterator JsonList::end() {
+	return data.end();
+}
+
+inline std::vector<json::Type>::const_iterator JsonList::end() const {
+	return data.end();
+}
+
+inline size_t JsonList::size() const {
+	return data.size();
+}
+
+inline void JsonList::clear() {
+	data.clear();
+}
+
+inline void JsonList::reserve(const size_t count) {
+	data.reserve(count);
+}
+
+/**
+ * Compares two objects by value. Key order does not matter.
+ */
+bool operator==(const JsonObject &a, const JsonObject &b);
+
+inline bool operator!=(const JsonObject &a, const JsonObject &b) {
+	return !(a == b);
+}
+
+/**
+ * Compares two lists by value.
+ */
+bool operator==(const JsonList &a, const JsonList &b);
+
+inline bool operator!=(const JsonList &a, const JsonList &b) {
+	return !(a == b);
+}
+
 /**
  * Calls to_pretty_stream on obj.
  */
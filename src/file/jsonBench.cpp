@@ -0,0 +1,172 @@
+#include "jsonBench.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <SDL.h>
+#include "json.h"
+#include "fileIO.h"
+
+/**
+ * Returns the seconds passed since the performance counter read start.
+ */
+static double seconds_since(const Uint64 start) {
+	return static_cast<double>(SDL_GetPerformanceCounter() - start) / static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+void json::bench_parse(const std::vector<std::string>& paths, const int copies, const int iterations, std::ostream& os) {
+	for (const std::string& path : paths) {
+		size_t size = 0;
+		const std::unique_ptr<char, SDLFreeDeleter> data(static_cast<char*>(SDL_LoadFile(path.c_str(), &size)));
+		if (data == nullptr) {
+			throw file_exception("File exception: " + std::string(SDL_GetError()));
+		}
+		std::string doc = "{\"copies\":[";
+		doc.reserve(doc.size() + (size + 1) * copies + 2);
+		for (int i = 0; i < copies; ++i) {
+			if (i != 0) doc += ',';
+			doc.append(data.get(), size);
+		}
+		doc += "]}";
+
+		std::vector<double> times;
+		size_t parsed = 0;
+		for (int i = 0; i < iterations; ++i) {
+			const Uint64 start = SDL_GetPerformanceCounter();
+			const JsonObject obj = json::read_from_buffer(doc.data(), doc.size());
+			times.push_back(seconds_since(start));
+			// Used, so that the parse cannot be optimized out.
+			parsed += obj.get<JsonList>("copies").size();
+		}
+		std::sort(times.begin(), times.end());
+		const double best = times.empty() ? 0.0 : times.front();
+		const double median = times.empty() ? 0.0 : times[times.size() / 2];
+		os << path << ": " << doc.size() / 1024 << " KiB (" << parsed / std::max(iterations, 1) << " copies), best "
+			<< best * 1000.0 << " ms, median " << median * 1000.0 << " ms, "
+			<< (best > 0.0 ? static_cast<double>(doc.size()) / best / (1024.0 * 1024.0) : 0.0) << " MiB/s" << std::endl;
+	}
+}
+
+void json::bench_keys(const int lookups, std::ostream& os) {
+	for (const int size : {4, 16, 64, 1024}) {
+		JsonObject obj;
+		std::vector<std::string> names;
+		for (int i = 0; i < size; ++i) {
+			names.push_back("binding_" + std::to_string(i));
+			obj.set(names.back(), i);
+		}
+		const std::vector<JsonKey> keys(names.begin(), names.end());
+		const int rounds = std::max(lookups / size, 1);
+		const double count = static_cast<double>(rounds) * size;
+		// Summed and printed, so that the lookups cannot be optimized out.
+		long long found = 0;
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int r = 0; r < rounds; ++r) {
+			for (const std::string& name : names) {
+				found += obj.get<int>(name);
+			}
+		}
+		const double string_time = seconds_since(start);
+		start = SDL_GetPerformanceCounter();
+		for (int r = 0; r < rounds; ++r) {
+			for (const JsonKey& key : keys) {
+				found += obj.get<int>(key);
+			}
+		}
+		const double key_time = seconds_since(start);
+		os << size << " keys: " << string_time * 1e9 / count << " ns per lookup with std::string, "
+			<< key_time * 1e9 / count << " ns with JsonKey (checksum " << found << ")" << std::endl;
+	}
+}
+
+/**
+ * Returns a random finite double. Mixes values from random bits, which cover every exponent and denormals,
+ * short decimals like the ones in config files, and edge cases.
+ */
+static double random_double(std::mt19937_64& rng) {
+	static const double EDGES[] = {
+		0.0, -0.0, 1.0, -1.0, 0.1, 1e-300, 5e-324, -5e-324, 2.2250738585072014e-308,
+		std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(), 9007199254740993.0, 1e21, 1e22
+	};
+	switch (rng() % 4) {
+		case 0:
+			return EDGES[rng() % (sizeof(EDGES) / sizeof(EDGES[0]))];
+		case 1:
+			return static_cast<double>(static_cast<int64_t>(rng() % 2000001) - 1000000) / 1000.0;
+		default:
+			while (true) {
+				const uint64_t bits = rng();
+				double d;
+				memcpy(&d, &bits, sizeof(d));
+				if (std::isfinite(d)) return d;
+			}
+	}
+}
+
+static int random_int(std::mt19937_64& rng) {
+	switch (rng() % 4) {
+		case 0:
+			return (rng() % 2 == 0) ? std::numeric_limits<int>::max() : std::numeric_limits<int>::min();
+		case 1:
+			return static_cast<int>(rng() % 201) - 100;
+		default:
+			return static_cast<int>(static_cast<uint32_t>(rng()));
+	}
+}
+
+bool json::check_number_roundtrip(const int count, const uint64_t seed, std::ostream& os) {
+	constexpr int MAX_REPORTED = 10;
+	std::mt19937_64 rng(seed);
+	JsonList ints, doubles;
+	ints.reserve(count);
+	doubles.reserve(count);
+	for (int i = 0; i < count; ++i) {
+		ints.push_back(random_int(rng));
+		doubles.push_back(random_double(rng));
+	}
+	JsonObject obj;
+	obj.set("ints", ints);
+	obj.set("doubles", doubles);
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	std::ostringstream out;
+	obj.to_stream(out);
+	const std::string text = out.str();
+	const double write_time = seconds_since(start);
+	start = SDL_GetPerformanceCounter();
+	const JsonObject read = json::read_from_buffer(text.data(), text.size());
+	const double read_time = seconds_since(start);
+
+	int mismatches = 0;
+	const auto report = [&os, &mismatches](const char* kind, const int index, const json::Type& written, const json::Type& got) {
+		if (++mismatches > MAX_REPORTED) return;
+		os << kind << " " << index << " written as ";
+		json::to_stream(os, written);
+		os << " read back as ";
+		json::to_stream(os, got);
+		os << std::endl;
+	};
+	const JsonList& read_ints = read.get<JsonList>("ints");
+	const JsonList& read_doubles = read.get<JsonList>("doubles");
+	for (int i = 0; i < count; ++i) {
+		const int* got = std::get_if<int>(&read_ints.get(i));
+		if (got == nullptr || *got != ints.get<int>(i)) {
+			report("int", i, ints.get(i), read_ints.get(i));
+		}
+		const double* got_d = std::get_if<double>(&read_doubles.get(i));
+		if (got_d == nullptr || memcmp(got_d, &doubles.get<double>(i), sizeof(double)) != 0) {
+			report("double", i, doubles.get(i), read_doubles.get(i));
+		}
+	}
+	const double mb = static_cast<double>(text.size()) / (1024.0 * 1024.0);
+	os << "Round-tripped " << count << " ints and " << count << " doubles through " << text.size() / 1024 << " KiB of json" << std::endl;
+	os << "Write " << write_time * 1000.0 << " ms (" << (write_time > 0.0 ? mb / write_time : 0.0) << " MiB/s), read "
+		<< read_time * 1000.0 << " ms (" << (read_time > 0.0 ? mb / read_time : 0.0) << " MiB/s)" << std::endl;
+	os << mismatches << " mismatches" << std::endl;
+	return mismatches == 0;
+}
@@ -0,0 +1,34 @@
+#ifndef JSON_BENCH_00_H
+#define JSON_BENCH_00_H
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+ * Benchmarks of the json reader and writer, run from the command line so that their numbers can be reproduced.
+ */
+namespace json {
+
+	/**
+	 * Parses each file in paths scaled up to a list of copies copies of its content, iterations times,
+	 * and prints the size, best and median parse time and throughput to os.
+	 * Throws file_exception if a file cannot be read and json_exception if one cannot be parsed.
+	 */
+	void bench_parse(const std::vector<std::string>& paths, int copies, int iterations, std::ostream& os);
+
+	/**
+	 * Times lookups of every key of generated objects of a few sizes, lookups times in total per size,
+	 * once with std::string keys hashed on every lookup and once with JsonKeys hashed beforehand. Prints ns per lookup to os.
+	 */
+	void bench_keys(int lookups, std::ostream& os);
+
+	/**
+	 * Writes count random ints and count random finite doubles, including edge cases like denormals, -0.0 and the
+	 * int limits, as json and reads them back. Prints the write and read throughput and the first mismatches to os.
+	 * Returns true if every number read back has the type and exact bits it was written with.
+	 */
+	bool check_number_roundtrip(int count, uint64_t seed, std::ostream& os);
+}
+
+#endif
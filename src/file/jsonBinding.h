@@ -0,0 +1,126 @@
+#ifndef JSON_BINDING_00_H
+#define JSON_BINDING_00_H
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include "json.h"
+
+/*
+ * Typed decoding of JsonObjects into structs.
+ * A struct is made decodable by specializing json::Fields with a constexpr tuple of field descriptors:
+ *
+ *	template<>
+ *	struct json::Fields<Foo> {
+ *		static constexpr auto value = std::make_tuple(
+ *			json::field("width", &Foo::width),
+ *			json::field("name", &Foo::name)
+ *		);
+ *	};
+ *
+ * Members can be int, double, bool, std::string, JsonObject, JsonList or another decodable struct.
+ * Key hashes are computed at compile time, every key is looked up once,
+ * and all missing or mistyped keys are reported together.
+ */
+namespace json {
+
+	/**
+	 * Describes that the value at key is stored in member of S.
+	 */
+	template<class S, class T>
+	struct Field {
+		JsonKey key;
+		T S::* member;
+	};
+
+	template<class S, class T>
+	constexpr Field<S, T> field(const char* key, T S::* member) {
+		return {key, member};
+	}
+
+	/**
+	 * Specialize with a static constexpr tuple of Fields named value to make S decodable.
+	 */
+	template<class S>
+	struct Fields;
+
+	template<class S, class = void>
+	struct is_decodable : std::false_type {};
+
+	template<class S>
+	struct is_decodable<S, std::void_t<decltype(Fields<S>::value)>> : std::true_type {};
+
+	template<class T>
+	constexpr const char* type_name() {
+		if constexpr (std::is_same_v<T, int>) return "an int";
+		else if constexpr (std::is_same_v<T, double>) return "a double";
+		else if constexpr (std::is_same_v<T, bool>) return "a bool";
+		else if constexpr (std::is_same_v<T, std::string>) return "a string";
+		else if constexpr (std::is_same_v<T, JsonList>) return "a list";
+		else return "an object";
+	}
+
+	template<class S>
+	void decode_fields(const JsonObject& obj, S* out, const std::string& prefix, std::string& errors);
+
+	/**
+	 * Decodes the value at field.key into out (unless out is nullptr), appending any error to errors.
+	 */
+	template<class S, class T>
+	void decode_field(const JsonObject& obj, const Field<S, T>& field, S* out, const std::string& prefix, std::string& errors) {
+		const json::Type* val = obj.find_value(field.key);
+		if (val == nullptr) {
+			if (!errors.empty()) errors += ", ";
+			errors += "missing " + prefix + std::string(field.key.name());
+			return;
+		}
+		if constexpr (is_decodable<T>::value) {
+			if (const JsonObject* sub = std::get_if<JsonObject>(val)) {
+				decode_fields<T>(*sub, out == nullptr ? nullptr : &(out->*field.member), prefix + std::string(field.key.name()) + '.', errors);
+				return;
+			}
+		} else {
+			if (const T* v = std::get_if<T>(val)) {
+				if (out != nullptr) out->*field.member = *v;
+				return;
+			}
+		}
+		if (!errors.empty()) errors += ", ";
+		errors += prefix + std::string(field.key.name()) + " is not " + type_name<T>();
+	}
+
+	template<class S>
+	void decode_fields(const JsonObject& obj, S* out, const std::string& prefix, std::string& errors) {
+		std::apply([&](const auto&... fields) {
+			(decode_field(obj, fields, out, prefix, errors), ...);
+		}, Fields<S>::value);
+	}
+
+	/**
+	 * Decodes obj into a S. Throws a json_exception listing every bad field, prefixed by what.
+	 */
+	template<class S>
+	S decode(const JsonObject& obj, const std::string& what) {
+		S res{};
+		std::string errors;
+		decode_fields<S>(obj, &res, "", errors);
+		if (!errors.empty()) {
+			throw json_exception(what + " is invalid: " + errors);
+		}
+		return res;
+	}
+
+	/**
+	 * Checks that obj could be decoded into a S, without decoding it.
+	 * Throws a json_exception listing every bad field, prefixed by what.
+	 */
+	template<class S>
+	void check(const JsonObject& obj, const std::string& what) {
+		std::string errors;
+		decode_fields<S>(obj, nullptr, "", errors);
+		if (!errors.empty()) {
+			throw json_exception(what + " is invalid: " + errors);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include "jsonSnapshot.h"
+#include "fileIO.h"
+#include "engine/profiler.h"
+
+constexpr uint32_t SNAPSHOT_MAGIC = 0x504E534A; // "JSNP"
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+/**
+ * Tags written before every value in a snapshot.
+ */
+enum class SnapshotTag : uint8_t {
+	OBJECT = 0,		// u32 count, then count keys (u32 length, bytes) each followed by a value.
+	LIST = 1,		// u32 count, then count values.
+	INT = 2,		// i32.
+	DOUBLE = 3,		// 8 byte double.
+	TRUE = 4,
+	FALSE = 5,
+	STRING = 6,		// u32 length, then bytes.
+	NULL_VALUE = 7
+};
+
+/**
+ * Information about the source of a snapshot. The snapshot is only used if all of it matches.
+ */
+struct SnapshotSource {
+	uint64_t size;
+	int64_t mtime;
+	uint64_t hash;
+};
+
+/**
+ * Hashes data 8 bytes at a time. Not cryptographic, only meant to notice changed files.
+ */
+static uint64_t hash_content(const char* data, const size_t size) {
+	constexpr uint64_t PRIME = 0x9E3779B97F4A7C15ull;
+	uint64_t h = size * PRIME;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t w;
+		memcpy(&w, data + i, 8);
+		h = (h ^ w) * PRIME;
+		h ^= h >> 29;
+	}
+	for (; i < size; ++i) {
+		h = (h ^ static_cast<unsigned char>(data[i])) * PRIME;
+	}
+	return h ^ (h >> 32);
+}
+
+/**
+ * Reads values from a snapshot buffer. Throws json_exception if the data ends early or is malformed.
+ */
+struct SnapshotReader {
+	const char* cur;
+	const char* end;
+
+	template<class T>
+	T read() {
+		if (static_cast<size_t>(end - cur) < sizeof(T)) throw json_exception("Truncated snapshot");
+		T t;
+		memcpy(&t, cur, sizeof(T));
+		cur += sizeof(T);
+		return t;
+	}
+
+	std::string_view read_string() {
+		const uint32_t len = read<uint32_t>();
+		if (static_cast<size_t>(end - cur) < len) throw json_exception("Truncated snapshot");
+		std::string_view s(cur, len);
+		cur += len;
+		return s;
+	}
+};
+
+static json::Type read_snapshot_value(SnapshotReader &in);
+
+static JsonObject read_snapshot_object(SnapshotReader &in) {
+	JsonObject obj;
+	const uint32_t count = in.read<uint32_t>();
+	// Every entry takes at least 5 bytes, so a corrupt count cannot reserve more than the file size.
+	obj.reserve(std::min<size_t>(count, (in.end - in.cur) / 5));
+	for (uint32_t i = 0; i < count; ++i) {
+		const std::string_view key = in.read_string();
+		obj.set(key, read_snapshot_value(in));
+	}
+	return obj;
+}
+
+static json::Type read_snapshot_value(SnapshotReader &in) {
+	switch (static_cast<SnapshotTag>(in.read<uint8_t>())) {
+		case SnapshotTag::OBJECT:
+			return read_snapshot_object(in);
+		case SnapshotTag::LIST: {
+			JsonList list;
+			const uint32_t count = in.read<uint32_t>();
+			list.reserve(std::min<size_t>(count, in.end - in.cur));
+			for (uint32_t i = 0; i < count; ++i) {
+				list.push_back(read_snapshot_value(in));
+			}
+			return list;
+		}
+		case SnapshotTag::INT:
+			return in.read<int32_t>();
+		case SnapshotTag::DOUBLE:
+			return in.read<double>();
+		case SnapshotTag::TRUE:
+			return true;
+		case SnapshotTag::FALSE:
+			return false;
+		case SnapshotTag::STRING:
+			return std::string(in.read_string());
+		case SnapshotTag::NULL_VALUE:
+			return JsonNull();
+		default:
+			throw json_exception("Invalid tag in snapshot");
+	}
+}
+
+static void write_snapshot_string(FileWriter &writer, const std::string& s) {
+	writer.write(static_cast<uint32_t>(s.size()));
+	writer.write_many(s.data(), static_cast<int>(s.size()));
+}
+
+static void write_snapshot_value(FileWriter &writer, const json::Type& val);
+
+static void write_snapshot_object(FileWriter &writer, const JsonObject& obj) {
+	writer.write(static_cast<uint32_t>(obj.size()));
+	for (const JsonObject::Entry& entry : obj) {
+		write_snapshot_string(writer, *entry.key);
+		write_snapshot_value(writer, entry.value);
+	}
+}
+
+static void write_snapshot_value(FileWriter &writer, const json::Type& val) {
+	if (const JsonObject *obj = std::get_if<JsonObject>(&val)) {
+		writer.write(SnapshotTag::OBJECT);
+		write_snapshot_object(writer, *obj);
+	} else if (const JsonList *list = std::get_if<JsonList>(&val)) {
+		writer.write(SnapshotTag::LIST);
+		writer.write(static_cast<uint32_t>(list->size()));
+		for (const json::Type& el : *list) {
+			write_snapshot_value(writer, el);
+		}
+	} else if (std::holds_alternative<JsonNull>(val)) {
+		writer.write(SnapshotTag::NULL_VALUE);
+	} else if (const int* i = std::get_if<int>(&val)) {
+		writer.write(SnapshotTag::INT);
+		writer.write(static_cast<int32_t>(*i));
+	} else if (const double* d = std::get_if<double>(&val)) {
+		writer.write(SnapshotTag::DOUBLE);
+		writer.write(*d);
+	} else if (const bool* b = std::get_if<bool>(&val)) {
+		writer.write(*b ? SnapshotTag::TRUE : SnapshotTag::FALSE);
+	} else if (const std::string *s = std::get_if<std::string>(&val)) {
+		writer.write(SnapshotTag::STRING);
+		write_snapshot_string(writer, *s);
+	}
+}
+
+/**
+ * Reads the snapshot at snapshot_path. Throws if it does not exist, is malformed or was made from another source.
+ */
+static JsonObject read_snapshot(const std::string& snapshot_path, const std::string& key, const SnapshotSource& source) {
+	size_t size = 0;
+	std::unique_ptr<char, SDLFreeDeleter> data(static_cast<char*>(SDL_LoadFile(snapshot_path.c_str(), &size)));
+	if (data == nullptr) {
+		throw file_exception("File exception: " + std::string(SDL_GetError()));
+	}
+	SnapshotReader in = {data.get(), data.get() + size};
+	if (
+		in.read<uint32_t>() != SNAPSHOT_MAGIC ||
+		in.read<uint32_t>() != SNAPSHOT_VERSION ||
+		in.read<uint64_t>() != source.size ||
+		in.read<int64_t>() != source.mtime ||
+		in.read<uint64_t>() != source.hash ||
+		in.read_string() != key ||
+		in.read<uint8_t>() != static_cast<uint8_t>(SnapshotTag::OBJECT)
+	) {
+		throw json_exception("Outdated snapshot");
+	}
+	JsonObject obj = read_snapshot_object(in);
+	if (in.cur != in.end) {
+		throw json_exception("Trailing data in snapshot");
+	}
+	return obj;
+}
+
+/**
+ * Returns the absolute path of path, which identifies its snapshot.
+ */
+static std::string get_snapshot_key(const std::string& path) {
+	std::error_code ec;
+	const std::filesystem::path absolute = std::filesystem::absolute(path, ec);
+	return ec ? path : absolute.string();
+}
+
+/**
+ * Returns where the snapshot with key is kept in the per-user cache directory, or an empty string if there is none.
+ * Snapshots are named by a hash of their key, which they also store to catch collisions.
+ */
+static std::string get_snapshot_path(const std::string& key) {
+	static const std::string cache_dir = [] {
+		const std::unique_ptr<char, SDLFreeDeleter> pref(SDL_GetPrefPath("ClimbGame", "ClimbGame"));
+		return pref == nullptr ? std::string() : std::string(pref.get());
+	}();
+	if (cache_dir.empty()) return "";
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.snapshot", static_cast<unsigned long long>(hash_content(key.data(), key.size())));
+	return cache_dir + name;
+}
+
+static void write_snapshot(const std::string& snapshot_path, const std::string& key, const SnapshotSource& source, const JsonObject& obj) {
+	FileWriter writer(snapshot_path, true);
+	writer.write(SNAPSHOT_MAGIC);
+	writer.write(SNAPSHOT_VERSION);
+	writer.write(source.size);
+	writer.write(source.mtime);
+	writer.write(source.hash);
+	write_snapshot_string(writer, key);
+	writer.write(SnapshotTag::OBJECT);
+	write_snapshot_object(writer, obj);
+	if (!writer.flush()) {
+		throw file_exception("Could not write snapshot, " + std::string(SDL_GetError()));
+	}
+}
+
+JsonObject json::read_from_file_cached(const std::string& path) {
+	PROFILE_ZONE("json::read_from_file_cached");
+	size_t size = 0;
+	std::unique_ptr<char, SDLFreeDeleter> data(static_cast<char*>(SDL_LoadFile(path.c_str(), &size)));
+	if (data == nullptr) {
+		throw file_exception("File exception: " + std::string(SDL_GetError()));
+	}
+	std::error_code ec;
+	const auto mtime = std::filesystem::last_write_time(path, ec);
+	const SnapshotSource source = {
+		size,
+		ec ? 0 : static_cast<int64_t>(mtime.time_since_epoch().count()),
+		hash_content(data.get(), size)
+	};
+	const std::string key = get_snapshot_key(path);
+	const std::string snapshot_path = get_snapshot_path(key);
+	if (snapshot_path.empty()) {
+		return json::read_from_buffer(data.get(), size);
+	}
+	try {
+		return read_snapshot(snapshot_path, key, source);
+	} catch (const base_exception&) {
+		// Missing or outdated, parse the text below.
+	}
+	JsonObject obj = json::read_from_buffer(data.get(), size);
+	try {
+		write_snapshot(snapshot_path, key, source, obj);
+	} catch (const base_exception&) {
+		// The snapshot is only an optimization, the next start will parse the text again.
+	}
+	return obj;
+}
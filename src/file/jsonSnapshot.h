@@ -0,0 +1,21 @@
+#ifndef JSON_SNAPSHOT_00_H
+#define JSON_SNAPSHOT_00_H
+#include <string>
+#include "json.h"
+
+/*
+ * Binary snapshots of parsed json files, so that unchanged files do not have to be parsed again.
+ * Snapshots are stored in the per-user directory from SDL_GetPrefPath, so the sources may be read-only,
+ * and record the path, size, modification time and a hash of the source they were made from.
+ */
+namespace json {
+
+	/**
+	 * Reads a JsonObject from path, using the snapshot of path if it matches the file.
+	 * Otherwise the file is parsed as text and a new snapshot is written.
+	 * Throws the same exceptions as read_from_file.
+	 */
+	JsonObject read_from_file_cached(const std::string& path);
+}
+
+#endif
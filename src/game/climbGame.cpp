@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include "climbGame.h"
@@ -13,33 +14,31 @@ constexpr int PLAYER_START_Y = 320;
 constexpr int CAMERA_PAN_REGION = 200;
 constexpr double CAMERA_SPEED = 1000.0;
 
-void ClimbGame::tick(const Uint64 delta, StateStatus& res) {
-	if (delta == 0) return;
-	double dDelta = static_cast<double>(delta) / 1000.0;
-
+void ClimbGame::tick(const double delta, StateStatus& res) {
     handle_input(res);
 	for (const auto& e : entities) {
-		e->tick(dDelta, level);
+		e->tick(delta, level);
 	}
 	const Vector2D &pos = player->get_position();
 	double camera_y_delta = pos.y - camera_y;
 
 	if (camera_y_delta < CAMERA_PAN_REGION) {
-		camera_y -= std::min(CAMERA_SPEED * dDelta, CAMERA_PAN_REGION - camera_y_delta);
+		camera_y -= std::min(CAMERA_SPEED * delta, CAMERA_PAN_REGION - camera_y_delta);
 		if (camera_y < camera_y_min) camera_y = camera_y_min;
 	}
 	else if (camera_y_delta > SCREEN_HEIGHT - CAMERA_PAN_REGION) {
-		camera_y += std::min(CAMERA_SPEED * dDelta, camera_y_delta - SCREEN_HEIGHT + CAMERA_PAN_REGION);
+		camera_y += std::min(CAMERA_SPEED * delta, camera_y_delta - SCREEN_HEIGHT + CAMERA_PAN_REGION);
 		if (camera_y > camera_y_max) camera_y = camera_y_max;
 	}
 }
 
 void ClimbGame::handle_input(StateStatus &res) {
 	const Vector2D &vel = player->get_velocity(); 
-	if (left_input->is_pressed(window_state->keyboard_state, window_state->mouse_mask) && vel.x > -MAX_MOVEMENT_VEL) {
+	const ActionSet held = actions.get_held(window_state->keyboard_state, window_state->mouse_mask);
+	if (held[LEFT] && vel.x > -MAX_MOVEMENT_VEL) {
 		player->add_acceleration(-MOVEMENT_ACCELERATION, 0);
 	}
-	if (right_input->is_pressed(window_state->keyboard_state, window_state->mouse_mask) && vel.x < MAX_MOVEMENT_VEL) 
+	if (held[RIGHT] && vel.x < MAX_MOVEMENT_VEL) 
 	{
 		player->add_acceleration(MOVEMENT_ACCELERATION, 0);
 	}
@@ -64,21 +63,43 @@ void ClimbGame::render() {
 	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 	SDL_RenderFillRect(gRenderer, nullptr);
 
-	level.render(static_cast<int>(camera_y));
-	player->render(static_cast<int>(camera_y));
-	
-	SDL_RenderPresent(gRenderer);
+	const ClimbSnapshot& snapshot = snapshots.read();
+	level.render(static_cast<int>(snapshot.camera_y));
+	Player::render(snapshot.player, static_cast<int>(snapshot.camera_y));
 }
 
-void ClimbGame::init(WindowState* ws) {
-	State::init(ws);
-	create_inputs();
+void ClimbGame::publish() {
+	ClimbSnapshot& snapshot = snapshots.write_buffer();
+	snapshot.camera_y = camera_y;
+	player->write_snapshot(snapshot.player);
+	snapshots.publish();
+}
 
-	std::pair<std::string, const JsonObject&> lvl1 = config::get_level_and_config(0);
+bool ClimbGame::is_threaded() const {
+	return true;
+}
+
+bool ClimbGame::is_recordable() const {
+	return true;
+}
 
+std::unique_ptr<engine::TaskGroup> ClimbGame::load() {
+	std::pair<std::string, const JsonObject&> lvl1 = config::get_level_and_config(0);
 	level.set_screen_size(SCREEN_WIDTH, SCREEN_HEIGHT);
 
-	level.load_from_file(lvl1.first, lvl1.second);
+	auto group = std::make_unique<engine::TaskGroup>();
+	group->run([this, path = lvl1.first, level_config = lvl1.second] {
+		level.load(path, level_config);
+	});
+	group->run([this, player_json = config::get_template("Player")] {
+		decoded_player = DecodedTemplate::from_json(player_json);
+	});
+	return group;
+}
+
+void ClimbGame::init(WindowState* ws) {
+	State::init(ws);
+	create_inputs();
 	
 	game_viewport = {
 		window_state->screen_width / 2 - SCREEN_WIDTH / 2, 
@@ -86,68 +107,123 @@ void ClimbGame::init(WindowState* ws) {
 		SCREEN_WIDTH,
 		SCREEN_HEIGHT
 	};
-	
-	const int tile_size = level.get_tile_size();
 
-	visible_tiles_x = SCREEN_WIDTH / tile_size;
-	visible_tiles_y = SCREEN_HEIGHT / tile_size;
 	camera_y = PLAYER_START_Y;
-	camera_y_max = tile_size * (level.get_height() - visible_tiles_y);
-	camera_y_min = 0;
-	if (camera_y < camera_y_min) camera_y = camera_y_min;
-	if (camera_y > camera_y_max) camera_y = camera_y_max;
+	level.create_textures();
+	fit_camera();
 
 	Player* p = new Player();
 	
 	player.reset(p);
 
-	player_template.reset(EntityTemplate::from_json(config::get_template("Player")));
+	player_template.reset(decoded_player->create());
+	decoded_player.reset();
 	player->init(*player_template);
 
 	player->set_position(PLAYER_START_X, PLAYER_START_Y);
 	entities.push_back(player);
+	publish();
 	
 	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xAA, 0xFF, 0xFF);
 	SDL_RenderClear(gRenderer);
 }
 
+void ClimbGame::load_level() {
+	std::pair<std::string, const JsonObject&> lvl1 = config::get_level_and_config(0);
+
+	level.load_from_file(lvl1.first, lvl1.second);
+	fit_camera();
+}
 
+void ClimbGame::fit_camera() {
+	const int tile_size = level.get_tile_size();
+
+	visible_tiles_x = SCREEN_WIDTH / tile_size;
+	visible_tiles_y = SCREEN_HEIGHT / tile_size;
+	camera_y_max = tile_size * (level.get_height() - visible_tiles_y);
+	camera_y_min = 0;
+	if (camera_y < camera_y_min) camera_y = camera_y_min;
+	if (camera_y > camera_y_max) camera_y = camera_y_max;
+}
+
+void ClimbGame::invalidate(const std::vector<std::string>& keys) {
+	const auto changed = [&keys](const std::string& key) {
+		return std::find(keys.begin(), keys.end(), key) != keys.end();
+	};
+	if (changed(config::level_key(0))) {
+		try {
+			load_level();
+		} catch (const base_exception& e) {
+			std::cout << "Could not reload level, " << e.msg << std::endl;
+		}
+	}
+	if (changed(config::template_key("Player"))) {
+		try {
+			// The player points into its template, so it is moved over before the old one is freed.
+			std::unique_ptr<EntityTemplate> new_template(EntityTemplate::from_json(config::get_template("Player")));
+			player->init(*new_template);
+			player_template = std::move(new_template);
+			// Render may still hold a snapshot pointing to the old textures.
+			publish();
+		} catch (const base_exception& e) {
+			std::cout << "Could not reload player template, " << e.msg << std::endl;
+		}
+	}
+}
+
+
+void ClimbGame::report(std::ostream& os) const {
+	const Vector2D& pos = player->get_position();
+	const Vector2D& vel = player->get_velocity();
+	os << "Player position (" << pos.x << ", " << pos.y << "), velocity (" << vel.x << ", " << vel.y << "), "
+		<< (player->is_alive() ? "alive" : "dead") << ", camera y " << camera_y << std::endl;
+}
+
+Uint64 ClimbGame::hash_state() const {
+	StateHasher hasher;
+	hasher.add(camera_y);
+	hasher.add(static_cast<uint64_t>(entities.size()));
+	for (const std::shared_ptr<Entity>& e : entities) {
+		e->hash(hasher);
+	}
+	return hasher.get();
+}
 
 void ClimbGame::create_inputs() {
-	const JsonObject& controls = config::get_bindings(bindings::CLIMBGAME.key);
-
-	left_input = get_hold_input(controls.get<std::string>("left"), "None");
-	right_input = get_hold_input(controls.get<std::string>("right"), "None");
-	grapple_input = get_press_input(controls.get<std::string>("grapple"), "None");
-	pull_input = get_press_input(controls.get<std::string>("pull"), "None");
-	release_input = get_press_input(controls.get<std::string>("release"), "None");
-	jump_input = get_press_input(controls.get<std::string>("jump"), "None");
-	return_input = get_press_input(controls.get<std::string>("return_grapple"), "None");
+	static const ActionBinding BINDINGS[] = {
+		{LEFT, "left"}, {RIGHT, "right"}, {GRAPPLE, "grapple"}, {PULL, "pull"},
+		{RELEASE, "release"}, {JUMP, "jump"}, {RETURN_GRAPPLE, "return_grapple"}
+	};
+	actions.clear();
+	actions.load(config::get_bindings(bindings::CLIMBGAME.key), BINDINGS);
 }
 
 void ClimbGame::handle_down(const SDL_Keycode key, const Uint8 mouse) {
-	if (grapple_input->is_targeted(key, mouse)) {
+	const ActionSet targeted = actions.get_targeted(key, mouse);
+	if (targeted.none()) return;
+	if (targeted[GRAPPLE]) {
 		do_grapple = true;
 	}
-	if (pull_input->is_targeted(key, mouse)) {
+	if (targeted[PULL]) {
 		player->set_pull(true);
 	} 
-	if (release_input->is_targeted(key, mouse)) {
+	if (targeted[RELEASE]) {
 		player->set_release(true);
 	}
-	if (jump_input->is_targeted(key, mouse)) {
+	if (targeted[JUMP]) {
 		player->jump();
 	}
-	if (return_input->is_targeted(key, mouse)) {
+	if (targeted[RETURN_GRAPPLE]) {
 		player->return_grapple();
 	}
 }
 
 void ClimbGame::handle_up(const SDL_Keycode key, const Uint8 mouse) {
-	if (pull_input->is_targeted(key, mouse)) {
+	const ActionSet targeted = actions.get_targeted(key, mouse);
+	if (targeted[PULL]) {
 		player->set_pull(false);
 	} 
-	if (release_input->is_targeted(key, mouse)) {
+	if (targeted[RELEASE]) {
 		player->set_release(false);
 	}
 }
\ No newline at end of file
@@ -6,26 +6,74 @@
 #include "util/utilities.h"
 #include "engine/game.h"
 #include "engine/input.h"
+#include "engine/tripleBuffer.h"
 #include "globals.h"
 #include "level.h"
 #include "entity.h"
 
 
+/**
+ * Everything ClimbGame::render draws besides the level, published after every tick.
+ */
+struct ClimbSnapshot {
+	double camera_y = 0.0;
+	PlayerSnapshot player;
+};
+
 class ClimbGame : public State {
 	public:
 		ClimbGame() : State(), level(TILE_SIZE) {}
 
-		void tick(Uint64 delta, StateStatus& res) override;
+		void tick(double delta, StateStatus& res) override;
+
+		/**
+		 * Reads the level and draws its screens, and decodes the player template, on workers.
+		 */
+		std::unique_ptr<engine::TaskGroup> load() override;
 
 		void init(WindowState* window_state) override;
 
 		void render() override;
 
+		void publish() override;
+
+		[[nodiscard]] bool is_threaded() const override;
+
+		[[nodiscard]] bool is_recordable() const override;
+
 		void handle_up(SDL_Keycode key, Uint8 mouse) override;
 
 		void handle_down(SDL_Keycode key, Uint8 mouse) override;
 
+		/**
+		 * Reloads the level or the player template if they changed.
+		 */
+		void invalidate(const std::vector<std::string>& keys) override;
+
+		/**
+		 * Writes the player state and camera position.
+		 */
+		void report(std::ostream& os) const override;
+
+		/**
+		 * Hashes the camera and every entity.
+		 */
+		[[nodiscard]] Uint64 hash_state() const override;
+
 	private:
+		enum Action {
+			LEFT, RIGHT, GRAPPLE, PULL, RELEASE, JUMP, RETURN_GRAPPLE
+		};
+
+		/**
+		 * Loads the level and fits the camera bounds to it.
+		 */
+		void load_level();
+
+		/**
+		 * Fits the camera bounds to the loaded level.
+		 */
+		void fit_camera();
 
 		void handle_input(StateStatus &res);
 
@@ -41,12 +89,15 @@ class ClimbGame : public State {
 
 		std::shared_ptr<Player> player;
 		
-		std::unique_ptr<PressInput> grapple_input, pull_input, release_input, jump_input, return_input;
-		std::unique_ptr<HoldInput> left_input, right_input;
+		ActionMap actions;
 		bool do_grapple = false;
 		
 		std::vector<std::shared_ptr<Entity>> entities;
 		std::unique_ptr<EntityTemplate> player_template;
+		// Made by load off the main thread, turned into player_template by init.
+		std::unique_ptr<DecodedTemplate> decoded_player;
+
+		TripleBuffer<ClimbSnapshot> snapshots;
 };
 
 
@@ -1,6 +1,11 @@
 #include "config.h"
 #include "file/fileIO.h"
+#include "file/jsonSnapshot.h"
+#include "engine/fileWatcher.h"
+#include "level.h"
+#include <algorithm>
 #include <iostream>
+#include <memory>
 
 #ifdef ROOT_BUILD
 const std::string PROJECT_ROOT = "./";
@@ -10,6 +15,7 @@ const std::string PROJECT_ROOT = "../../";
 const std::string CONFIG_FILE = PROJECT_ROOT + "config.json";
 
 bool VERBOSE = false;
+bool HOT_RELOAD = false;
 
 std::string ASSETS_ROOT = PROJECT_ROOT + "assets/";
 std::string CONFIG_ROOT = PROJECT_ROOT + "config/";
@@ -22,7 +28,7 @@ std::string STATIC_TEMPLATES_FILE = "static_templates.json";
 void config::init() {
 	JsonObject conf;
 	try {
-		conf = json::read_from_file(CONFIG_FILE);
+		conf = json::read_from_file_cached(CONFIG_FILE);
 	} catch(const base_exception& e) {
 		std::cout << e.msg << std::endl;
 		std::cout << "Using default configs" << std::endl;
@@ -32,6 +38,10 @@ void config::init() {
 		VERBOSE = conf.get<bool>("VERBOSE");
 	}
 
+	if (conf.has_key_of_type<bool>("HOT_RELOAD")) {
+		HOT_RELOAD = conf.get<bool>("HOT_RELOAD");
+	}
+
 	if (conf.has_key_of_type<std::string>("ASSETS_ROOT")) {
 		ASSETS_ROOT = PROJECT_ROOT + conf.get<std::string>("ASSETS_ROOT");
 	}
@@ -58,6 +68,7 @@ void config::init() {
 	std::cout << "LEVELS_FILE: " << LEVELS_FILE << std::endl;
 	std::cout << "OPTION_FILE: " << OPTION_FILE << std::endl;
 	std::cout << "STATIC_TEMPLATES_FILE: " << STATIC_TEMPLATES_FILE << std::endl;
+	std::cout << "HOT_RELOAD: " << HOT_RELOAD << std::endl;
 }
 
 bool options_loaded = false;
@@ -82,7 +93,7 @@ JsonObject& config::get_options() {
 	if (!options_loaded) {
 		if (VERBOSE) std::cout << "Loading " << CONFIG_ROOT << OPTION_FILE << std::endl;
 		try {
-			options = json::read_from_file(CONFIG_ROOT + OPTION_FILE);
+			options = json::read_from_file_cached(CONFIG_ROOT + OPTION_FILE);
 			if (!options.has_key_of_type<JsonObject>(bindings::KEY_NAME)) {
 				if (VERBOSE) std::cout << "No bindings in options file, using default bindings" << std::endl;
 				options.set<JsonObject>(bindings::KEY_NAME, JsonObject());
@@ -123,6 +134,37 @@ void config::reset_bindings() {
 
 constexpr int TOTAL_LEVELS = 1;
 
+// Watches loaded files when HOT_RELOAD is set, created on first use.
+std::unique_ptr<FileWatcher> watcher;
+
+// Watched assets, and the keys invalidated when they change.
+std::vector<std::pair<std::string, std::string>> asset_dependents;
+
+void watch_dependencies();
+
+/**
+ * Checks the contents of a levels file, adding default names to unnamed levels.
+ */
+void validate_levels(JsonObject& lvls_file) {
+	if (!lvls_file.has_key_of_type<JsonList>("LEVELS") || !lvls_file.has_key_of_type<JsonObject>("LEVEL_CONFIGURATIONS")) {
+		throw file_exception("Invalid levels file");
+	}
+	JsonList& lvls = lvls_file.get<JsonList>("LEVELS");
+	if (lvls.size() < TOTAL_LEVELS) {
+		throw file_exception("Levels missing from levels file");
+	}
+	for (size_t i = 0; i < lvls.size(); ++i) {
+		if(!lvls.has_index_of_type<JsonObject>(i)) throw file_exception("Invalid levels file");
+		JsonObject& obj = lvls.get<JsonObject>(i);
+		if (!obj.has_key_of_type<std::string>("file") || !obj.has_key_of_type<std::string>("config")) {
+			throw file_exception("Level" + std::to_string(i) + " is invalid");
+		}
+		if (!obj.has_key_of_type<std::string>("name")) {
+			obj.set<std::string>("name", "Unnamed_level_" + std::to_string(i));
+		}
+	}
+}
+
 bool levels_loaded = false;
 JsonObject levels;
 
@@ -130,25 +172,10 @@ const JsonList& config::get_levels() {
 	if(!levels_loaded) {
 		if (VERBOSE) std::cout << "Loading " << CONFIG_ROOT << LEVELS_FILE << std::endl;
 		//No try ... catch since failing to load levels cannot be handled.
-		levels = json::read_from_file(CONFIG_ROOT + LEVELS_FILE);
-		if (!levels.has_key_of_type<JsonList>("LEVELS") || !levels.has_key_of_type<JsonObject>("LEVEL_CONFIGURATIONS")) {
-			throw file_exception("Invalid levels file");
-		}
-		JsonList& lvls = levels.get<JsonList>("LEVELS");
-		if (lvls.size() < TOTAL_LEVELS) {
-			throw file_exception("Levels missing from levels file");
-		}
-		for (int i = 0; i < lvls.size(); ++i) {
-			if(!lvls.has_index_of_type<JsonObject>(i)) throw file_exception("Invalid levels file");
-			JsonObject& obj = lvls.get<JsonObject>(i);
-			if (!obj.has_key_of_type<std::string>("file") || !obj.has_key_of_type<std::string>("config")) {
-				throw file_exception("Level" + std::to_string(i) + " is invalid");
-			}
-			if (!obj.has_key_of_type<std::string>("name")) {
-				obj.set<std::string>("name", "Unnamed_level_" + std::to_string(i));
-			}
-		}
+		levels = json::read_from_file_cached(CONFIG_ROOT + LEVELS_FILE);
+		validate_levels(levels);
 		levels_loaded = true;
+		watch_dependencies();
 	}
 	return levels.get<JsonList>("LEVELS");
 }
@@ -164,14 +191,7 @@ const JsonObject& config::get_level_config(const std::string& key) {
 		throw file_exception("Level config " + key + " unknown");
 	}
 	const JsonObject& lvl_config = cnf.get<JsonObject>(key);
-	if (!lvl_config.has_key_of_type<std::string>("tiles") || 
-		!lvl_config.has_key_of_type<std::string>("objects") ||
-		!lvl_config.has_key_of_type<int>("tile_count") ||
-		!lvl_config.has_key_of_type<int>("tile_size") ||
-		!lvl_config.has_key_of_type<int>("tile_width")
-	){
-		throw file_exception("Level config " + key + " is invalid");
-	}
+	json::check<LevelConfig>(lvl_config, "Level config " + key);
 	return lvl_config;
 }
 
@@ -183,17 +203,22 @@ std::pair<std::string, const JsonObject&> config::get_level_and_config(const int
 }
 
 
+void validate_templates(const JsonObject& templates) {
+	if(!templates.has_key_of_type<JsonObject>("Player")) {
+		throw file_exception("Player template missing");
+	}
+}
+
 bool static_templates_loaded = false;
 // Always loaded templates
 JsonObject static_templates;
 const JsonObject& config::get_template(const std::string& name) {
 	if (!static_templates_loaded) {
 		if (VERBOSE) std::cout << "Loading " << CONFIG_ROOT << STATIC_TEMPLATES_FILE << std::endl;
-		static_templates = json::read_from_file(CONFIG_ROOT + STATIC_TEMPLATES_FILE);
-		if(!static_templates.has_key_of_type<JsonObject>("Player")) {
-			throw file_exception("Player template missing");
-		}
+		static_templates = json::read_from_file_cached(CONFIG_ROOT + STATIC_TEMPLATES_FILE);
+		validate_templates(static_templates);
 		static_templates_loaded = true;
+		watch_dependencies();
 	}
 	return static_templates.get<JsonObject>(name);
 }
@@ -204,4 +229,175 @@ std::string config::get_asset_path(const std::string& path) {
 
 std::string config::get_level_path(const std::string& path) {
 	return LEVELS_ROOT + path;
-}
\ No newline at end of file
+}
+
+std::vector<std::string> config::get_json_files() {
+	return {CONFIG_FILE, CONFIG_ROOT + LEVELS_FILE, CONFIG_ROOT + OPTION_FILE, CONFIG_ROOT + STATIC_TEMPLATES_FILE};
+}
+
+const std::string LEVEL_KEY_PREFIX = "level:";
+
+std::string config::template_key(const std::string& name) {
+	return "template:" + name;
+}
+
+std::string config::level_key(const size_t index) {
+	return LEVEL_KEY_PREFIX + std::to_string(index);
+}
+
+bool config::is_level_key(const std::string& key) {
+	return key.compare(0, LEVEL_KEY_PREFIX.size(), LEVEL_KEY_PREFIX) == 0;
+}
+
+std::string config::level_config_key(const std::string& key) {
+	return "level_config:" + key;
+}
+
+void add_key(std::vector<std::string>& keys, const std::string& key) {
+	if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+		keys.push_back(key);
+	}
+}
+
+void add_dependency(const std::string& path, const std::string& key) {
+	watcher->watch(path);
+	asset_dependents.emplace_back(path, key);
+}
+
+/**
+ * Adds the asset path at obj.key.path as a dependency of dependent, if there is one.
+ */
+void add_texture_dependency(const JsonObject& obj, const JsonKey& key, const std::string& dependent) {
+	if (!obj.has_key_of_type<JsonObject>(key)) return;
+	const JsonObject& texture = obj.get<JsonObject>(key);
+	if (texture.has_key_of_type<std::string>("Path")) {
+		add_dependency(config::get_asset_path(texture.get<std::string>("Path")), dependent);
+	}
+}
+
+/**
+ * Watches the loaded config files, and the assets and level files they refer to.
+ */
+void watch_dependencies() {
+	if (!HOT_RELOAD) return;
+	if (watcher == nullptr) watcher = std::make_unique<FileWatcher>();
+	asset_dependents.clear();
+	if (static_templates_loaded) {
+		watcher->watch(CONFIG_ROOT + STATIC_TEMPLATES_FILE);
+		for (const JsonObject::Entry& entry : static_templates) {
+			if (!std::holds_alternative<JsonObject>(entry.value)) continue;
+			const JsonObject& templ = std::get<JsonObject>(entry.value);
+			add_texture_dependency(templ, "Texture", config::template_key(*entry.key));
+			add_texture_dependency(templ, "HookTexture", config::template_key(*entry.key));
+		}
+	}
+	if (levels_loaded) {
+		watcher->watch(CONFIG_ROOT + LEVELS_FILE);
+		const JsonList& lvls = levels.get<JsonList>("LEVELS");
+		const JsonObject& configs = levels.get<JsonObject>("LEVEL_CONFIGURATIONS");
+		for (size_t i = 0; i < lvls.size(); ++i) {
+			const JsonObject& lvl = lvls.get<JsonObject>(i);
+			add_dependency(config::get_level_path(lvl.get<std::string>("file")), config::level_key(i));
+			// A level is baked from the images of its config.
+			const std::string& conf = lvl.get<std::string>("config");
+			if (!configs.has_key_of_type<JsonObject>(conf)) continue;
+			for (const char* image : {"tiles", "objects"}) {
+				if (configs.get<JsonObject>(conf).has_key_of_type<std::string>(image)) {
+					add_dependency(config::get_asset_path(configs.get<JsonObject>(conf).get<std::string>(image)), config::level_key(i));
+				}
+			}
+		}
+		for (const JsonObject::Entry& entry : configs) {
+			if (!std::holds_alternative<JsonObject>(entry.value)) continue;
+			const JsonObject& conf = std::get<JsonObject>(entry.value);
+			for (const char* image : {"tiles", "objects"}) {
+				if (conf.has_key_of_type<std::string>(image)) {
+					add_dependency(config::get_asset_path(conf.get<std::string>(image)), config::level_config_key(*entry.key));
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Returns the keys whose values differ between old_obj and new_obj, including keys only in one of them.
+ */
+std::vector<std::string> changed_keys(const JsonObject& old_obj, const JsonObject& new_obj) {
+	std::vector<std::string> changed;
+	for (const JsonObject::Entry& entry : old_obj) {
+		const json::Type* val = new_obj.find_value(*entry.key);
+		if (val == nullptr || *val != entry.value) changed.push_back(*entry.key);
+	}
+	for (const JsonObject::Entry& entry : new_obj) {
+		if (!old_obj.has_key(*entry.key)) changed.push_back(*entry.key);
+	}
+	return changed;
+}
+
+void reload_templates(std::vector<std::string>& invalidated) {
+	JsonObject new_templates;
+	try {
+		new_templates = json::read_from_file_cached(CONFIG_ROOT + STATIC_TEMPLATES_FILE);
+		validate_templates(new_templates);
+	} catch (const base_exception& e) {
+		std::cout << "Could not reload " << STATIC_TEMPLATES_FILE << ", " << e.msg << std::endl;
+		return;
+	}
+	for (const std::string& name : changed_keys(static_templates, new_templates)) {
+		add_key(invalidated, config::template_key(name));
+	}
+	static_templates = std::move(new_templates);
+}
+
+void reload_levels(std::vector<std::string>& invalidated) {
+	JsonObject new_levels;
+	try {
+		new_levels = json::read_from_file_cached(CONFIG_ROOT + LEVELS_FILE);
+		validate_levels(new_levels);
+	} catch (const base_exception& e) {
+		std::cout << "Could not reload " << LEVELS_FILE << ", " << e.msg << std::endl;
+		return;
+	}
+	const JsonList& old_lvls = levels.get<JsonList>("LEVELS");
+	const JsonList& new_lvls = new_levels.get<JsonList>("LEVELS");
+	const std::vector<std::string> changed_configs = changed_keys(
+		levels.get<JsonObject>("LEVEL_CONFIGURATIONS"), new_levels.get<JsonObject>("LEVEL_CONFIGURATIONS")
+	);
+	for (const std::string& key : changed_configs) {
+		add_key(invalidated, config::level_config_key(key));
+	}
+	for (size_t i = 0; i < std::max(old_lvls.size(), new_lvls.size()); ++i) {
+		if (i >= old_lvls.size() || i >= new_lvls.size() || old_lvls.get(i) != new_lvls.get(i)) {
+			add_key(invalidated, config::level_key(i));
+		} else {
+			const std::string& conf = new_lvls.get<JsonObject>(i).get<std::string>("config");
+			if (std::find(changed_configs.begin(), changed_configs.end(), conf) != changed_configs.end()) {
+				add_key(invalidated, config::level_key(i));
+			}
+		}
+	}
+	levels = std::move(new_levels);
+}
+
+void config::poll_changes(std::vector<std::string>& invalidated) {
+	if (watcher == nullptr) return;
+	static std::vector<std::string> changed;
+	changed.clear();
+	watcher->poll(changed);
+	if (changed.empty()) return;
+	bool reloaded = false;
+	for (const std::string& path : changed) {
+		if (VERBOSE) std::cout << "Changed " << path << std::endl;
+		if (static_templates_loaded && path == CONFIG_ROOT + STATIC_TEMPLATES_FILE) {
+			reload_templates(invalidated);
+			reloaded = true;
+		} else if (levels_loaded && path == CONFIG_ROOT + LEVELS_FILE) {
+			reload_levels(invalidated);
+			reloaded = true;
+		}
+		for (const std::pair<std::string, std::string>& dep : asset_dependents) {
+			if (dep.first == path) add_key(invalidated, dep.second);
+		}
+	}
+	if (reloaded) watch_dependencies();
+}
@@ -68,6 +68,11 @@ namespace config {
 	
 	JsonObject& get_bindings(const std::string& key);
 	
+	/**
+	 * The references returned by get_levels, get_level, get_level_config, get_level_and_config and get_template
+	 * point into the loaded config files. They are invalidated when poll_changes reloads the file they came from,
+	 * so anything kept across calls to it has to be copied.
+	 */
 	const JsonList& get_levels();
 
 	const JsonObject& get_level(int index);
@@ -82,11 +87,41 @@ namespace config {
 	
 	void init();
 	
+	/**
+	 * Invalidated by poll_changes, like the level getters.
+	 */
 	const JsonObject& get_template(const std::string& name);
 	
 	std::string get_asset_path(const std::string& path);
 	
 	std::string get_level_path(const std::string& path);
+
+	/**
+	 * Returns the paths of the json files config reads.
+	 */
+	std::vector<std::string> get_json_files();
+
+	/**
+	 * Keys given to State::invalidate when a template, level or level config changes on disk.
+	 */
+	std::string template_key(const std::string& name);
+
+	std::string level_key(size_t index);
+
+	/**
+	 * Returns true if key was made by level_key.
+	 */
+	bool is_level_key(const std::string& key);
+
+	std::string level_config_key(const std::string& key);
+
+	/**
+	 * Re-reads the config files and assets that changed since the last call,
+	 * appending the keys of every template, level and level config that changed to invalidated.
+	 * A file that fails to load keeps its old contents. Does nothing unless HOT_RELOAD is set in the config file.
+	 * A reloaded file replaces the objects behind every reference the getters returned into it.
+	 */
+	void poll_changes(std::vector<std::string>& invalidated);
 }
 
 
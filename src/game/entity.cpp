@@ -2,8 +2,11 @@
 
 #include <memory>
 #include "engine/engine.h"
+#include "engine/profiler.h"
+#include "engine/renderQueue.h"
 #include "util/geometry.h"
 #include "config.h"
+#include "file/jsonBinding.h"
 
 constexpr double GRAVITY_ACCELERATION = 3000.0;
 constexpr double FRICTION_FACTOR = 700.0;
@@ -14,53 +17,116 @@ constexpr double GRAPPLE_SPEED = 1300.0;
 constexpr double GRAPPLE_PULL = 5000.0;
 constexpr double GRAPPLE_RELEASE = 200.0;
 constexpr double JUMP_VEL = 800.0;
+constexpr float ROPE_WIDTH = 2.0f;
 constexpr double ABSOLUTE_FRICTION_THRESHOLD = 5.0;
 
 constexpr int SPIKE_DAMAGE = 5;
 constexpr double INV_DURATION = 0.6;
 
-void texture_form_template(Texture& t, const JsonObject& text) {
-	if (
-		!text.has_key_of_type<std::string>("Path") ||
-		!text.has_key_of_type<int>("Width") || 
-		!text.has_key_of_type<int>("Height")
-	) {
-		throw json_exception("Bad entity template texture");
-	}
-	t.load_from_file(config::get_asset_path(text.get<std::string>("Path")));
-	t.set_dimensions(
-		text.get<int>("Width"),
-		text.get<int>("Height")
+/**
+ * Texture description in an entity template.
+ */
+struct TextureTemplate {
+	std::string path;
+	int width;
+	int height;
+};
+
+template<>
+struct json::Fields<TextureTemplate> {
+	static constexpr auto value = std::make_tuple(
+		json::field("Path", &TextureTemplate::path),
+		json::field("Width", &TextureTemplate::width),
+		json::field("Height", &TextureTemplate::height)
+	);
+};
+
+/**
+ * Fields shared by all entity templates.
+ */
+struct EntityFields {
+	std::string type;
+	TextureTemplate texture;
+	int width;
+	int height;
+};
+
+template<>
+struct json::Fields<EntityFields> {
+	static constexpr auto value = std::make_tuple(
+		json::field("Type", &EntityFields::type),
+		json::field("Texture", &EntityFields::texture),
+		json::field("Width", &EntityFields::width),
+		json::field("Height", &EntityFields::height)
 	);
+};
+
+/**
+ * Fields only used by the player template.
+ */
+struct PlayerFields {
+	TextureTemplate hook_texture;
+	int hp;
+};
+
+template<>
+struct json::Fields<PlayerFields> {
+	static constexpr auto value = std::make_tuple(
+		json::field("HookTexture", &PlayerFields::hook_texture),
+		json::field("Hp", &PlayerFields::hp)
+	);
+};
+
+/**
+ * Decodes the image of text, off the main thread if needed.
+ */
+static DecodedTemplate::Image decode_image(const TextureTemplate& text) {
+	return {load_surface(config::get_asset_path(text.path)), text.width, text.height};
 }
 
-EntityTemplate* EntityTemplate::from_json(const JsonObject& obj) {
-	if (
-		!obj.has_key_of_type<std::string>("Type") || 
-		!obj.has_key_of_type<JsonObject>("Texture") || 
-		!obj.has_key_of_type<int>("Width") || 
-		!obj.has_key_of_type<int>("Height")
-	) {
-		throw json_exception("Bad entity template");
+std::unique_ptr<DecodedTemplate> DecodedTemplate::from_json(const JsonObject& obj) {
+	// Both field lists are decoded before throwing, so a player template reports all its errors at once.
+	EntityFields fields{};
+	PlayerFields player{};
+	std::string errors;
+	json::decode_fields<EntityFields>(obj, &fields, "", errors);
+	const bool is_player = fields.type == "Player";
+	if (is_player) {
+		json::decode_fields<PlayerFields>(obj, &player, "", errors);
+	}
+	if (!errors.empty()) {
+		throw json_exception(std::string(is_player ? "Player" : "Entity") + " template is invalid: " + errors);
+	}
+
+	auto decoded = std::make_unique<DecodedTemplate>();
+	decoded->width = fields.width;
+	decoded->height = fields.height;
+	decoded->texture = decode_image(fields.texture);
+	if (is_player) {
+		decoded->is_player = true;
+		decoded->hp = player.hp;
+		decoded->hook_texture = decode_image(player.hook_texture);
 	}
-	const JsonObject& text = obj.get<JsonObject>("Texture");
-	int width = obj.get<int>("Width");
-	int height = obj.get<int>("Height");
-
-	const std::string& type = obj.get<std::string>("Type");
-	if (type == "Player") {
-		if (!obj.has_key_of_type<JsonObject>("HookTexture") || !obj.has_key_of_type<int>("Hp"))
-            throw json_exception("Bad player template");
-        Texture grappleTexture, texture;
-		texture_form_template(texture, text);
-		texture_form_template(grappleTexture, obj.get<JsonObject>("HookTexture"));
-        const int hp = obj.get<int>("Hp");
-		return new PlayerTemplate(width, height, hp, std::move(texture), std::move(grappleTexture));
-	} else {
-		Texture texture;
-		texture_form_template(texture, text);
-		return new EntityTemplate(width, height, std::move(texture));
+	return decoded;
+}
+
+Texture DecodedTemplate::create_texture(const Image& image) {
+	SDL_Texture* const texture = SDL_CreateTextureFromSurface(gRenderer, image.surface.get());
+	if (texture == nullptr) {
+		throw image_load_exception(std::string(SDL_GetError()));
+	}
+	return Texture(texture, image.width, image.height);
+}
+
+EntityTemplate* DecodedTemplate::create() const {
+	if (is_player) {
+		return new PlayerTemplate(width, height, hp, create_texture(texture), create_texture(hook_texture));
 	}
+	return new EntityTemplate(width, height, create_texture(texture));
+}
+
+EntityTemplate* EntityTemplate::from_json(const JsonObject& obj) {
+	return DecodedTemplate::from_json(obj)->create();
 }
 
 Entity::~Entity() = default;
@@ -101,7 +167,7 @@ void Entity::tick(const double delta, Level& level)
 void Entity::render(const int cameraY) 
 {
 	int x = static_cast<int>(pos.x), y = static_cast<int>(pos.y - cameraY);
-	texture->render(x, y);
+	gRenderQueue.copy(RenderLayer::ENTITIES, *texture, x, y);
 }
 
 
@@ -176,6 +242,14 @@ bool Entity::on_ground(const Level &level) const
 
 void Entity::hurt(int damage) {}
 
+void Entity::hash(StateHasher& hasher) const {
+	hasher.add(pos);
+	hasher.add(vel);
+	hasher.add(acc);
+	hasher.add(width);
+	hasher.add(height);
+}
+
 bool Entity::is_alive() const {
     return true;
 }
@@ -193,36 +267,40 @@ void Player::init(EntityTemplate &entity_template) {
     inv_time = 0.0;
 }
 
-void Player::render(const int cameraY) 
-{
-    Entity::render(cameraY);
-    if (grappling_mode == UNUSED) return;
-	
-	Corner prev_pos = {(pos.x + width / 2), (pos.y + height / 2)}; // NOLINT(bugprone-integer-division)
-	SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0xFF, 0xFF);
-	for (auto it = grapple_points.rbegin(); it != grapple_points.rend(); it++) 
-	{
-		SDL_RenderDrawLine(gRenderer,
-			static_cast<int>(prev_pos.x),
-			static_cast<int>(prev_pos.y - cameraY),
-			static_cast<int>(it->corner->x),
-			static_cast<int>(it->corner->y - cameraY)
-		);
-		prev_pos = *(it->corner);
+void Player::write_snapshot(PlayerSnapshot& snapshot) const {
+	snapshot.texture = texture;
+	snapshot.pos = pos;
+	snapshot.invulnerable = inv_time > 0.0;
+	snapshot.hook_texture = grapple_hook;
+	snapshot.rope.clear();
+	if (grappling_mode == UNUSED) return;
+	snapshot.hook = {hook->x, hook->y};
+	snapshot.rope.emplace_back(pos.x + width / 2, pos.y + height / 2); // NOLINT(bugprone-integer-division)
+	for (auto it = grapple_points.rbegin(); it != grapple_points.rend(); it++) {
+		snapshot.rope.emplace_back(it->corner->x, it->corner->y);
 	}
+}
+
+void Player::render(const PlayerSnapshot& snapshot, const int cameraY) 
+{
+	const SDL_Color color = snapshot.invulnerable ? SDL_Color{128, 255, 0, 255} : SDL_Color{255, 255, 255, 255};
+	gRenderQueue.copy(RenderLayer::PLAYER, *snapshot.texture, static_cast<int>(snapshot.pos.x), static_cast<int>(snapshot.pos.y - cameraY), color);
+	if (snapshot.rope.empty()) return;
 
-	grapple_hook->render(static_cast<int>(hook->x) - 2, static_cast<int>(hook->y - cameraY) - 2);
+	// The whole rope is a single batch of quads, instead of a draw call per segment.
+	gRenderQueue.polyline(RenderLayer::ROPE, snapshot.rope, 0.0, -cameraY, ROPE_WIDTH, {0x00, 0x00, 0xFF, 0xFF});
+
+	gRenderQueue.copy(RenderLayer::HOOK, *snapshot.hook_texture, static_cast<int>(snapshot.hook.x) - 2, static_cast<int>(snapshot.hook.y - cameraY) - 2);
 }
 
 
 
 void Player::tick(const double delta, Level &level)
 {
+	PROFILE_ZONE("Player::tick");
+    // The colour of an invulnerable player is set in render, which may run on another thread.
     if (inv_time > 0.0) {
         inv_time -= delta;
-        texture->set_color_mod(128, 255, 0);
-    } else {
-        texture->set_color_mod(255, 255, 255);
     }
 	Vector2D old_pos = {pos.x + width / 2, pos.y + height / 2}; // NOLINT(bugprone-integer-division)
 	if (is_on_ground) {
@@ -421,8 +499,13 @@ void Player::fire_grapple(const int targetX, const int targetY)
 		grapple_vel.y = targetY - (pos.y + height / 2); // NOLINT(bugprone-integer-division)
 		grapple_vel.normalize();
 		grapple_vel.scale(GRAPPLE_SPEED);
-		hook = std::make_shared<Corner>(pos.x + width / 2, pos.y + height / 2); // NOLINT(bugprone-integer-division)
-		center_point = std::make_shared<Corner>(pos.x + width / 2, pos.y + height / 2); // NOLINT(bugprone-integer-division)
+		// The grapple points were cleared, so nothing else points to the hook and center point, and they can be reused.
+		if (hook == nullptr) {
+			hook = std::make_shared<Corner>();
+			center_point = std::make_shared<Corner>();
+		}
+		*hook = Corner(pos.x + width / 2, pos.y + height / 2); // NOLINT(bugprone-integer-division)
+		*center_point = Corner(pos.x + width / 2, pos.y + height / 2); // NOLINT(bugprone-integer-division)
 		grapple_points.push_back({hook, false});
 		grapple_points.push_back({center_point, false});
 	} else if(grappling_mode == PLACED) {
@@ -439,7 +522,8 @@ void Player::set_release(bool b) {
 }
 
 void Player::update_grapple(CornerList &corners, Vector2D prev, bool first) {
-	CornerList contained;
+	PROFILE_ZONE("Player::update_grapple");
+	FrameCornerList contained;
 	update_grapple(corners, corners, contained, prev, first);
 	double len = 0.0;
 	for (unsigned i = 0; i < grapple_points.size() - 1; ++i) {
@@ -451,7 +535,8 @@ void Player::update_grapple(CornerList &corners, Vector2D prev, bool first) {
 	grapple_length = len;
 }
 
-void Player::update_grapple(CornerList &allCorners, CornerList &corners, CornerList &contained, Vector2D prev, bool first)
+template<class Corners>
+void Player::update_grapple(CornerList &allCorners, Corners &corners, FrameCornerList &contained, Vector2D prev, bool first)
 {
 	// Index of moved point, direction to go in vector.
 	int mp_index = 0, dir = 1;
@@ -504,7 +589,7 @@ void Player::update_grapple(CornerList &allCorners, CornerList &corners, CornerL
 	if (add_point) {
 		bool orientation = first != is_clockwise(anchor->x, anchor->y, to_be_added->x, to_be_added->y, cur->x, cur->y);
 		grapple_points.insert(grapple_points.begin() + mp_index + first, {to_be_added, orientation});
-		CornerList new_points;
+		FrameCornerList new_points;
 		new_points.swap(contained);
 		update_grapple(allCorners, new_points, contained, prev, first);
 	} else if (free_point) {
@@ -524,6 +609,32 @@ void Player::hurt(int damage) {
     }
 }
 
+void Player::hash(StateHasher& hasher) const {
+	Entity::hash(hasher);
+	hasher.add(static_cast<int>(grappling_mode));
+	hasher.add(grapple_length);
+	hasher.add(grapple_max_len);
+	hasher.add(hp);
+	hasher.add(inv_time);
+	hasher.add(pull);
+	hasher.add(release);
+	hasher.add(is_on_ground);
+	hasher.add(grapple_vel);
+	for (const std::shared_ptr<Corner>& corner : {hook, center_point}) {
+		hasher.add(corner != nullptr);
+		if (corner != nullptr) {
+			hasher.add(corner->x);
+			hasher.add(corner->y);
+		}
+	}
+	hasher.add(static_cast<uint64_t>(grapple_points.size()));
+	for (const GrapplePoint& point : grapple_points) {
+		hasher.add(point.corner->x);
+		hasher.add(point.corner->y);
+		hasher.add(point.orientation);
+	}
+}
+
 bool Player::is_alive() const {
     return hp > 0;
 }
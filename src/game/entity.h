@@ -5,6 +5,8 @@
 #include <memory>
 #include <utility>
 #include "util/utilities.h"
+#include "util/stateHash.h"
+#include "engine/frameArena.h"
 #include "engine/texture.h"
 #include "level.h"
 #include "globals.h"
@@ -18,9 +20,47 @@ class EntityTemplate {
 		const int h;
         Texture texture;
 		
+		/**
+		 * Reads a template and loads its textures, see DecodedTemplate. Must run on the main thread.
+		 */
 		static EntityTemplate* from_json(const JsonObject& obj);
 };
 
+/**
+ * An entity template read from json with its images decoded, which unlike EntityTemplate can be made off the main thread.
+ */
+class DecodedTemplate {
+	public:
+		/**
+		 * Decoded image, and the size it is drawn at.
+		 */
+		struct Image {
+			std::unique_ptr<SDL_Surface, SurfaceDeleter> surface;
+			int width = 0;
+			int height = 0;
+		};
+
+		/**
+		 * Reads obj and decodes the images it names, throwing json_exception or image_load_exception on failure.
+		 */
+		static std::unique_ptr<DecodedTemplate> from_json(const JsonObject& obj);
+
+		/**
+		 * Turns the decoded images into textures. Must run on the main thread.
+		 */
+		[[nodiscard]] EntityTemplate* create() const;
+
+	private:
+		bool is_player = false;
+		int width = 0;
+		int height = 0;
+		int hp = 0;
+		Image texture;
+		Image hook_texture;
+
+		[[nodiscard]] static Texture create_texture(const Image& image);
+};
+
 class PlayerTemplate : public EntityTemplate {
 	public:
 		PlayerTemplate(const int w, const int h, const int hp, Texture&& t, Texture&& gt)
@@ -97,6 +137,11 @@ class Entity {
 		 */
 		[[nodiscard]] const Vector2D &get_position() const;
 
+		/**
+		 * Adds everything that affects how this entity moves to hasher.
+		 */
+		virtual void hash(StateHasher& hasher) const;
+
 	protected:
 		/**
 		 * Protected constructor for subclasses.
@@ -129,6 +174,20 @@ class GrapplePoint {
 };
 
 
+/**
+ * What is needed to draw the player, copied after every tick so that it can be drawn while the next tick runs.
+ */
+struct PlayerSnapshot {
+	Texture* texture = nullptr;
+	Vector2D pos;
+	bool invulnerable = false;
+
+	const Texture* hook_texture = nullptr;
+	Vector2D hook;
+	// Points of the rope from the player to the hook, empty if the grapple is not used.
+	std::vector<Vector2D> rope;
+};
+
 class Player : public Entity {
 	public:
 		~Player() override;
@@ -136,7 +195,15 @@ class Player : public Entity {
 
 		void init(EntityTemplate &entity_template) override;
 
-		void render(int cameraY) override;
+		/**
+		 * Copies what is needed to draw this player into snapshot.
+		 */
+		void write_snapshot(PlayerSnapshot& snapshot) const;
+
+		/**
+		 * Draws a player from a snapshot, considering the camera location.
+		 */
+		static void render(const PlayerSnapshot& snapshot, int cameraY);
 
 		void tick(double delta, Level &level) override;
 
@@ -144,6 +211,8 @@ class Player : public Entity {
 
         bool is_alive() const override;
 
+		void hash(StateHasher& hasher) const override;
+
 		void fire_grapple(int target_x, int target_y);
 
 		void return_grapple();
@@ -157,6 +226,8 @@ class Player : public Entity {
 	private:
 		
 		typedef std::vector<std::shared_ptr<Corner>> CornerList;
+		// Corners found during a single update, in the frame arena.
+		typedef FrameVector<std::shared_ptr<Corner>> FrameCornerList;
 		
 		void place_grapple(double x, double y, double dx, double dy, int tile_size, CornerList &corners);
 		
@@ -167,9 +238,10 @@ class Player : public Entity {
 		void update_grapple(CornerList &corners, Vector2D prev, bool first);
 		 
 		/**
-		 * Recursive helper for updating grapple points.
+		 * Recursive helper for updating grapple points. Corners is either CornerList or FrameCornerList.
 		 */
-		void update_grapple(CornerList &allCorners, CornerList &corners, CornerList &contained, Vector2D prev, bool first);
+		template<class Corners>
+		void update_grapple(CornerList &allCorners, Corners &corners, FrameCornerList &contained, Vector2D prev, bool first);
 	
 		enum GrapplingMode
 		{
@@ -4,6 +4,9 @@
 #include <string>
 #include "level.h"
 #include "engine/engine.h"
+#include "engine/jobs.h"
+#include "engine/profiler.h"
+#include "engine/renderQueue.h"
 #include "file/fileIO.h"
 #include "util/exceptions.h"
 #include "globals.h"
@@ -33,24 +36,23 @@ void LevelData::load_from_file(const std::string& path, const Uint32 tile_count)
 }
 
 void LevelData::write_to_file(const std::string& path) const {
-	FileWriter writer = FileWriter(path, true, true);
+	// Levels are loaded on every level start, so favour decoding speed over size.
+	FileWriter writer = FileWriter(path, true, Codec::LZ);
 	if (
 		!writer.write(width) ||
 		!writer.write(height) ||
-		!writer.write_many(data.get(), width * height)
+		!writer.write_many(data.get(), width * height) ||
+		!writer.flush()
 	) {
 		throw file_exception("Could not write to level file");
 	}
 }
 
 LevelConfig LevelConfig::load_from_json(const JsonObject& obj) {
-	return {
-		obj.get<int>("tile_size"),
-		obj.get<int>("tile_width"),
-		obj.get<int>("tile_count"),
-		config::get_asset_path(obj.get<std::string>("tiles")),
-		config::get_asset_path(obj.get<std::string>("objects"))
-	};
+	LevelConfig conf = json::decode<LevelConfig>(obj, "Level config");
+	conf.tiles_path = config::get_asset_path(conf.tiles_path);
+	conf.objects_path = config::get_asset_path(conf.objects_path);
+	return conf;
 }
 
 void Level::set_screen_size(const int sw, const int sh) {
@@ -60,24 +62,27 @@ void Level::set_screen_size(const int sw, const int sh) {
 
 
 void Level::load_from_file(const std::string& path, const JsonObject& obj) {
+	load(path, obj);
+	create_textures();
+}
+
+void Level::load(const std::string& path, const JsonObject& obj) {
+	PROFILE_ZONE("Level::load");
 	LevelConfig conf = LevelConfig::load_from_json(obj);
 	LevelData level_data;
-	level_data.load_from_file(path, conf.img_tilecount);
-
-
-	std::unique_ptr<SDL_Surface, SurfaceDeleter> tiles(IMG_Load(conf.tiles_path.c_str()));
-	if (tiles == nullptr) {
-		throw image_load_exception(std::string(IMG_GetError()));
-	}
-	std::unique_ptr<SDL_Surface, SurfaceDeleter> objects(IMG_Load(conf.objects_path.c_str()));
-	if (objects == nullptr) {
-		throw image_load_exception(std::string(IMG_GetError()));
+	std::unique_ptr<SDL_Surface, SurfaceDeleter> tiles, objects;
+	{
+		// The level file and both images are decoded in parallel.
+		engine::TaskGroup decode;
+		decode.run([&] { level_data.load_from_file(path, conf.img_tilecount); });
+		decode.run([&] { tiles = load_surface(conf.tiles_path); });
+		decode.run([&] { objects = load_surface(conf.objects_path); });
+		decode.wait();
 	}
 
 	int visible_screens = level_data.height / TILE_HEIGHT;
 	
-	std::unique_ptr<std::unique_ptr<SDL_Surface, SurfaceDeleter>[]> surfaces = 
-		std::make_unique<std::unique_ptr<SDL_Surface, SurfaceDeleter>[]>(visible_screens);
+	std::vector<std::unique_ptr<SDL_Surface, SurfaceDeleter>> surfaces(visible_screens);
 
 	for (int i = 0; i < visible_screens; ++i) {
 		surfaces[i].reset(SDL_CreateRGBSurfaceWithFormat(
@@ -121,54 +126,68 @@ void Level::load_from_file(const std::string& path, const JsonObject& obj) {
 		}
 	}
 
-	level_textures.clear();
-	for (int i = 0; i < visible_screens; ++i) {
-		SDL_Texture* texture = SDL_CreateTextureFromSurface(gRenderer, surfaces[i].get());
-		level_textures.emplace_back(texture, screen_width, screen_height);
-	}
-
-
+	screen_surfaces = std::move(surfaces);
 
 	this->width = static_cast<int>(level_data.width);
 	this->height = static_cast<int>(level_data.height);
 	create_corners();
 }
 
+void Level::create_textures() {
+	level_textures.clear();
+	for (const std::unique_ptr<SDL_Surface, SurfaceDeleter>& surface : screen_surfaces) {
+		SDL_Texture* texture = SDL_CreateTextureFromSurface(gRenderer, surface.get());
+		level_textures.emplace_back(texture, screen_width, screen_height);
+	}
+	screen_surfaces.clear();
+}
+
 void Level::create_corners() {
-	for (int x = 0; x < width; ++x) {
-		for (int y = 0; y < height; ++y) {
-			if (get_tile(x, y) != Tile::BLOCKED) continue;
-			bool top_left = true, top_right = true, bottom_left = true, bottom_right = true;
-			if (get_tile(x - 1, y) == Tile::BLOCKED) {
-				top_left = false;
-                bottom_left = false;
-			}
-			if (get_tile(x + 1, y) == Tile::BLOCKED) {
-				top_right = false;
-				bottom_right = false;
-			}
-			if (get_tile(x, y - 1) == Tile::BLOCKED) {
-				top_left = false;
-				top_right = false;
-			}
-			if (get_tile(x, y + 1) == Tile::BLOCKED) {
-                bottom_left = false;
-				bottom_right = false;
-			}
-			double x_pos = static_cast<double>(x), y_pos = static_cast<double>(y);
-			if (top_left) {
-				corners.push_back(std::make_shared<Corner>(x_pos * tile_size, y_pos * tile_size));
-			}
-			if (top_right) {
-				corners.push_back(std::make_shared<Corner>((x_pos + 1) * tile_size, y_pos * tile_size));
-			}
-			if (bottom_left) {
-				corners.push_back(std::make_shared<Corner>(x_pos * tile_size, (y_pos + 1) * tile_size));
-			}
-			if (bottom_right) {
-				corners.push_back(std::make_shared<Corner>((x_pos + 1) * tile_size, (y_pos + 1) * tile_size));
+	PROFILE_ZONE("Level::create_corners");
+	// Ranges of columns are scanned in parallel, and joined in order so corners come out as from a serial scan.
+	constexpr int COLUMNS_PER_TASK = 8;
+	std::vector<std::vector<std::shared_ptr<Corner>>> found((width + COLUMNS_PER_TASK - 1) / COLUMNS_PER_TASK);
+	engine::parallel_for(0, width, COLUMNS_PER_TASK, [this, &found](const int lo, const int hi) {
+		std::vector<std::shared_ptr<Corner>>& range_corners = found[lo / COLUMNS_PER_TASK];
+		for (int x = lo; x < hi; ++x) {
+			for (int y = 0; y < height; ++y) {
+				if (get_tile(x, y) != Tile::BLOCKED) continue;
+				bool top_left = true, top_right = true, bottom_left = true, bottom_right = true;
+				if (get_tile(x - 1, y) == Tile::BLOCKED) {
+					top_left = false;
+					bottom_left = false;
+				}
+				if (get_tile(x + 1, y) == Tile::BLOCKED) {
+					top_right = false;
+					bottom_right = false;
+				}
+				if (get_tile(x, y - 1) == Tile::BLOCKED) {
+					top_left = false;
+					top_right = false;
+				}
+				if (get_tile(x, y + 1) == Tile::BLOCKED) {
+					bottom_left = false;
+					bottom_right = false;
+				}
+				double x_pos = static_cast<double>(x), y_pos = static_cast<double>(y);
+				if (top_left) {
+					range_corners.push_back(std::make_shared<Corner>(x_pos * tile_size, y_pos * tile_size));
+				}
+				if (top_right) {
+					range_corners.push_back(std::make_shared<Corner>((x_pos + 1) * tile_size, y_pos * tile_size));
+				}
+				if (bottom_left) {
+					range_corners.push_back(std::make_shared<Corner>(x_pos * tile_size, (y_pos + 1) * tile_size));
+				}
+				if (bottom_right) {
+					range_corners.push_back(std::make_shared<Corner>((x_pos + 1) * tile_size, (y_pos + 1) * tile_size));
+				}
 			}
 		}
+	});
+	corners.clear();
+	for (std::vector<std::shared_ptr<Corner>>& range_corners : found) {
+		corners.insert(corners.end(), range_corners.begin(), range_corners.end());
 	}
 }
 
@@ -177,10 +196,11 @@ std::vector<std::shared_ptr<Corner>>& Level::get_corners() {
 }
 
 void Level::render(int cameraY) {
+	PROFILE_ZONE("Level::render");
 	int first = cameraY / screen_height;
 	int last = (cameraY + 2 * screen_height - 1) / screen_height;
 	for (int i = first; i < last; ++i) {
-		level_textures[i].render(0, i * screen_height - cameraY);
+		gRenderQueue.copy(RenderLayer::LEVEL, level_textures[i], 0, i * screen_height - cameraY);
 	}
 }
 
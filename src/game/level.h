@@ -3,6 +3,7 @@
 #include "util/utilities.h"
 #include "engine/texture.h"
 #include "file/json.h"
+#include "file/jsonBinding.h"
 
 
 /**
@@ -32,6 +33,17 @@ struct LevelConfig {
 	static LevelConfig load_from_json(const JsonObject& obj);
 };
 
+template<>
+struct json::Fields<LevelConfig> {
+	static constexpr auto value = std::make_tuple(
+		json::field("tile_size", &LevelConfig::img_tilesize),
+		json::field("tile_width", &LevelConfig::img_tilewidth),
+		json::field("tile_count", &LevelConfig::img_tilecount),
+		json::field("tiles", &LevelConfig::tiles_path),
+		json::field("objects", &LevelConfig::objects_path)
+	);
+};
+
 class Corner {
 	public:
 		double x = 0, y = 0;
@@ -57,8 +69,22 @@ class Level : public TileMap<Tile> {
 			this->tile_size = tile_size;
 		}
 
+		/**
+		 * Loads the level at path, see load and create_textures.
+		 */
 		void load_from_file(const std::string& path, const JsonObject& config);
 
+		/**
+		 * Reads the level at path and draws its screens into surfaces.
+		 * Does not use the renderer, so it can run off the main thread.
+		 */
+		void load(const std::string& path, const JsonObject& config);
+
+		/**
+		 * Turns the screens drawn by load into textures. Must run on the main thread.
+		 */
+		void create_textures();
+
 		void render(int cameraY);
 
 		std::vector<std::shared_ptr<Corner>>& get_corners();
@@ -70,6 +96,9 @@ class Level : public TileMap<Tile> {
 
 		std::vector<Texture> level_textures;
 
+		// Screens drawn by load, waiting for create_textures.
+		std::vector<std::unique_ptr<SDL_Surface, SurfaceDeleter>> screen_surfaces;
+
 		std::vector<std::shared_ptr<Corner>> corners;
 
 		void create_corners();
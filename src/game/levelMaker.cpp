@@ -1,8 +1,10 @@
 #include "levelMaker.h"
 #include "util/exceptions.h"
 #include "config.h"
+#include "engine/profiler.h"
 #include "nativefiledialog/nfdcpp.h"
 #include <algorithm>
+#include <iostream>
 
 // Tile appearance (0xUUSSIITT)
 // UU = unused
@@ -22,29 +24,31 @@ constexpr int SCALE_FACTORS_LEN = 16;
 constexpr int MAX_TILE_SCALE = 8;
 constexpr int TOTAL_OBJECTS = 1;
 
+std::unique_ptr<engine::TaskGroup> LevelMaker::load() {
+	auto group = std::make_unique<engine::TaskGroup>();
+	group->run([this] { tiles = load_surface(level_config.tiles_path); });
+	group->run([this] { objects = load_surface(level_config.objects_path); });
+	group->run([this, path = config::get_asset_path("marker.png")] { marker = load_surface(path); });
+	return group;
+}
+
 void LevelMaker::init(WindowState* ws) {
 	State::init(ws);
 	SDL_SetWindowTitle(gWindow, "LevelMaker");
 
-	const JsonObject& controls = config::get_bindings(bindings::LEVELMAKER.key);
-	zoom_in_input = get_press_input(controls.get<std::string>("zoom_in"), "None");
-	zoom_out_input = get_press_input(controls.get<std::string>("zoom_out"), "None");
-	put_tile_input = get_press_input(controls.get<std::string>("place_tile"), "None");
-	clear_tile_input = get_press_input(controls.get<std::string>("clear_tile"), "None");
-
-	left_input = get_press_input(controls.get<std::string>("navigate_left"), "None");
-	right_input = get_press_input(controls.get<std::string>("navigate_right"), "None");
-	up_input = get_press_input(controls.get<std::string>("navigate_up"), "None");
-	down_input = get_press_input(controls.get<std::string>("navigate_down"), "None");
-	
-	save_input = get_press_input(controls.get<std::string>("save_level"), "None");
-	tiles_input = get_press_input(controls.get<std::string>("tiles_mode"), "None");
-    collisions_input = get_press_input(controls.get<std::string>("collision_mode"), "None");
-    tile_collisions_input = get_press_input(controls.get<std::string>("tile_collisions"), "None");
-	tile_scale_up_input = get_press_input(controls.get<std::string>("tile_scale_up"), "None");
-	tile_scale_down_input = get_press_input(controls.get<std::string>("tile_scale_down"), "None");
-	camera_pan_input = get_hold_input(controls.get<std::string>("camera_pan"), "None");
-	exit_input = get_hold_input(config::get_bindings(bindings::GENERAL.key).get<std::string>("exit_menu"), "None");
+	static const ActionBinding BINDINGS[] = {
+		{ZOOM_IN, "zoom_in"}, {ZOOM_OUT, "zoom_out"}, {PUT_TILE, "place_tile"}, {CLEAR_TILE, "clear_tile"},
+		{LEFT, "navigate_left"}, {RIGHT, "navigate_right"}, {UP, "navigate_up"}, {DOWN, "navigate_down"},
+		{SAVE, "save_level"}, {TILES_MODE, "tiles_mode"}, {COLLISIONS_MODE, "collision_mode"},
+		{TILE_COLLISIONS, "tile_collisions"}, {TILE_SCALE_UP, "tile_scale_up"}, {TILE_SCALE_DOWN, "tile_scale_down"},
+		{CAMERA_PAN, "camera_pan"}
+	};
+	static const ActionBinding GENERAL_BINDINGS[] = {
+		{EXIT, "exit_menu"}
+	};
+	actions.clear();
+	actions.load(config::get_bindings(bindings::LEVELMAKER.key), BINDINGS);
+	actions.load(config::get_bindings(bindings::GENERAL.key), GENERAL_BINDINGS);
 
 	tiles_viewport = {
 		window_state->screen_width - TILE_SELECTOR_SIZE * TILE_SELECTOR_TW,
@@ -77,28 +81,7 @@ void LevelMaker::init(WindowState* ws) {
 		tiles_viewport.w,
 		window_state->screen_height - tiles_viewport.h
 	};
-	
-	{
-		SDL_Surface* t = IMG_Load(level_config.objects_path.c_str());
-		if (t == nullptr) {
-			throw image_load_exception(std::string(IMG_GetError()));
-		}
-		objects.reset(t);
-	}
-
-
-	SDL_Surface* t = IMG_Load(level_config.tiles_path.c_str());
-	if (t == nullptr) {
-		throw image_load_exception(std::string(IMG_GetError()));
-	}
-	tiles.reset(t);
 
-	SDL_Surface* m = IMG_Load(config::get_asset_path("marker.png").c_str());
-	if (m == nullptr) {
-		throw image_load_exception(std::string(IMG_GetError()));
-	}
-	marker.reset(m);
-	
 	window_surface = SDL_GetWindowSurface(gWindow);
 }
 
@@ -204,59 +187,86 @@ void LevelMaker::handle_wheel(const SDL_MouseWheelEvent &e) {
 }
 		
 void LevelMaker::handle_down(const SDL_Keycode key, const Uint8 mouse) {
-	if (put_tile_input->is_targeted(key, mouse)) {
+	const ActionSet targeted = actions.get_targeted(key, mouse);
+	if (targeted.none()) return;
+	if (targeted[PUT_TILE]) {
 		tile_press(true);
 	} 
-	if (clear_tile_input->is_targeted(key, mouse)) {
+	if (targeted[CLEAR_TILE]) {
 		tile_press(false);
 	}
-	if (zoom_in_input->is_targeted(key, mouse)) {
+	if (targeted[ZOOM_IN]) {
 		zoom(true);
-	} else if (zoom_out_input->is_targeted(key, mouse)) {
+	} else if (targeted[ZOOM_OUT]) {
 		zoom(false);
 	} 
-	if (left_input->is_targeted(key, mouse)) {
+	if (targeted[LEFT]) {
 		camera_x -= DEFAULT_TS * SCALE_FACTORS[scale_factor] / 3.0;
 		updated = true;
-	} else if (right_input->is_targeted(key, mouse)) {
+	} else if (targeted[RIGHT]) {
 		camera_x += DEFAULT_TS * SCALE_FACTORS[scale_factor] / 3.0;
 		updated = true;
 	}
-	if (up_input->is_targeted(key, mouse)) {
+	if (targeted[UP]) {
 		camera_y -= DEFAULT_TS * SCALE_FACTORS[scale_factor] / 3.0;
 		updated = true;
-	} else if (down_input->is_targeted(key, mouse)) {
+	} else if (targeted[DOWN]) {
 		camera_y += DEFAULT_TS * SCALE_FACTORS[scale_factor] / 3.0;
 		updated = true;
 	}
-	if (save_input->is_targeted(key, mouse)) {
+	if (targeted[SAVE]) {
 		std::string path;
 		if (nfd::SaveDialog(path) == NFD_OKAY) {
-			level_data.write_to_file(path);
+			save(path);
 		}
 	}
-	if (tiles_input->is_targeted(key, mouse)) {
+	if (targeted[TILES_MODE]) {
 		editor_mode = PLACE_TILES;
 		updated = true;
-	} else if (collisions_input->is_targeted(key, mouse)) {
+	} else if (targeted[COLLISIONS_MODE]) {
 		editor_mode = PLACE_COLLISIONS;
 		updated = true;
 	}
-	if (tile_collisions_input->is_targeted(key, mouse)) {
+	if (targeted[TILE_COLLISIONS]) {
         tile_collisions = !tile_collisions;
 	}
-	if (tile_scale_up_input->is_targeted(key, mouse) && tile_scale < MAX_TILE_SCALE) {
+	if (targeted[TILE_SCALE_UP] && tile_scale < MAX_TILE_SCALE) {
 		tile_scale++;
 		
-	} else if (tile_scale_down_input->is_targeted(key, mouse) && tile_scale > 1) {
+	} else if (targeted[TILE_SCALE_DOWN] && tile_scale > 1) {
 		tile_scale--;
 	}
 }
 
-void LevelMaker::tick(const Uint64 delta, StateStatus& res) {
-	if (exit_input->is_pressed(window_state->keyboard_state, window_state->mouse_mask)) {
+void LevelMaker::save(const std::string& path) {
+	const size_t size = static_cast<size_t>(level_data.width) * level_data.height;
+	auto copy = std::make_shared<LevelData>();
+	copy->width = level_data.width;
+	copy->height = level_data.height;
+	copy->data = std::make_unique<Uint32[]>(size);
+	std::copy(level_data.data.get(), level_data.data.get() + size, copy->data.get());
+	// One save at a time, so that two saves to the same file cannot interleave.
+	saving.wait();
+	saving.run([copy, path, alive = std::weak_ptr<const bool>(alive)] {
+		std::string title = "LevelMaker - saved " + path;
+		try {
+			copy->write_to_file(path);
+		} catch (const base_exception& e) {
+			std::cout << e.msg << std::endl;
+			title = "LevelMaker - could not save " + path;
+		}
+		// The window may only be changed on the main thread.
+		engine::run_on_main_thread([title, alive] {
+			if (!alive.expired()) SDL_SetWindowTitle(gWindow, title.c_str());
+		});
+	});
+}
+
+void LevelMaker::tick(const double delta, StateStatus& res) {
+	const ActionSet held = actions.get_held(window_state->keyboard_state, window_state->mouse_mask);
+	if (held[EXIT]) {
 		res.action = StateStatus::POP;
-	} else if (camera_pan_input->is_pressed(window_state->keyboard_state, window_state->mouse_mask)) {
+	} else if (held[CAMERA_PAN]) {
 		int mouse_dx = 0, mouse_dy = 0;
 		SDL_GetRelativeMouseState(&mouse_dx, &mouse_dy);
 		camera_x -= mouse_dx;
@@ -269,6 +279,7 @@ void LevelMaker::tick(const Uint64 delta, StateStatus& res) {
 
 void LevelMaker::render() {
 	if (!updated) return;
+	PROFILE_ZONE("LevelMaker::render");
 
 	const double ts = DEFAULT_TS * SCALE_FACTORS[scale_factor];
 	
@@ -354,6 +365,19 @@ void LevelMaker::render() {
 		SDL_BlitScaled(marker.get(), nullptr, window_surface, &dest);
 	}
 	updated = false;
-	
+	drawn = true;
+}
+
+void LevelMaker::present() {
+	if (!drawn) return;
+	drawn = false;
 	SDL_UpdateWindowSurface(gWindow);
 }
+
+bool LevelMaker::is_idle() const {
+	return true;
+}
+
+bool LevelMaker::is_vsynced() const {
+	return false;
+}
@@ -15,13 +15,33 @@ class LevelMaker : public State {
 
 		void handle_down(SDL_Keycode key, Uint8 mouse) override;
 
+		/**
+		 * Decodes the tile, object and marker images on workers.
+		 */
+		std::unique_ptr<engine::TaskGroup> load() override;
+
 		void init(WindowState* window_state) override;
 	
 		void handle_wheel(const SDL_MouseWheelEvent &e) override;
 
 		void render() override;
+
+		/**
+		 * Updates the window surface if render drew a new frame.
+		 */
+		void present() override;
+
+		/**
+		 * Returns true, the editor only changes on input.
+		 */
+		[[nodiscard]] bool is_idle() const override;
+
+		/**
+		 * Returns false, the window surface is updated without waiting for vsync.
+		 */
+		[[nodiscard]] bool is_vsynced() const override;
 		
-		void tick(Uint64 delta, StateStatus& res) override;
+		void tick(double delta, StateStatus& res) override;
 	private:
 
 		void zoom(bool in);
@@ -34,6 +54,12 @@ class LevelMaker : public State {
 
 		void place_spike(int x_tile, int y_tile);
 
+		/**
+		 * Writes a copy of the level to path on a worker, so editing can go on meanwhile.
+		 * The window title shows the result once the write is done.
+		 */
+		void save(const std::string& path);
+
 		std::unique_ptr<SDL_Surface, SurfaceDeleter> tiles;
 		std::unique_ptr<SDL_Surface, SurfaceDeleter> objects;
 		std::unique_ptr<SDL_Surface, SurfaceDeleter> marker;
@@ -41,13 +67,14 @@ class LevelMaker : public State {
 		// window_surface is owned by the gWindow instance, and will be freed when gWindow is freed.
 		SDL_Surface* window_surface = nullptr;
 		
-		std::unique_ptr<PressInput> 
-			zoom_in_input, zoom_out_input, 
-			put_tile_input, clear_tile_input,
-			left_input, right_input, up_input, down_input,
-			save_input, tiles_input, collisions_input, tile_collisions_input,
-			tile_scale_up_input, tile_scale_down_input;
-		std::unique_ptr<HoldInput> camera_pan_input, exit_input;
+		enum Action {
+			ZOOM_IN, ZOOM_OUT, PUT_TILE, CLEAR_TILE,
+			LEFT, RIGHT, UP, DOWN,
+			SAVE, TILES_MODE, COLLISIONS_MODE, TILE_COLLISIONS,
+			TILE_SCALE_UP, TILE_SCALE_DOWN, CAMERA_PAN, EXIT
+		};
+
+		ActionMap actions;
 
 		int selected = 0;
 
@@ -59,6 +86,7 @@ class LevelMaker : public State {
 		LevelConfig level_config;
 		bool tile_collisions = true;
 		bool updated = true;
+		bool drawn = false;
 
 		int scale_factor = 0;
 		int min_scale_factor = 0;
@@ -68,6 +96,12 @@ class LevelMaker : public State {
 
 		// Number of tiles of one side of the texture (1-8). Uint32 so that tile_scale << 16 fits.
 		Uint32 tile_scale = 1; 
+
+		// Expires with the editor, so that a save finishing after it is closed leaves the window title alone.
+		std::shared_ptr<const bool> alive = std::make_shared<const bool>(true);
+
+		// Saves still being written, waited for when the editor is destroyed.
+		engine::TaskGroup saving;
 		
 };
 
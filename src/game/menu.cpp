@@ -3,7 +3,10 @@
 #include "climbGame.h"
 #include "levelMaker.h"
 #include "config.h"
+#include "engine/renderQueue.h"
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <memory>
 
 const std::string MainMenu::BUTTON_NAMES[] = {"Start Game", "Level Maker", "Options"};
@@ -53,67 +56,117 @@ void OptionsMenu::init(WindowState* ws) {
 
 	const JsonObject& bindings = config::get_bindings();
 
-	camera_y = 0;
-	int h_offset = MARGIN_Y;
-	int group_start = 0;
 	for (auto it = bindings.keys_begin(); it != bindings.keys_end(); ++it) {
-		text.emplace_back((window_state->screen_width - 120) / 2, h_offset, 120, 60, *it, 25);
+		lines.push_back({Line::HEADER, static_cast<int>(groups.size()), 0});
+		groups.push_back(*it);
 		const JsonObject& group = bindings.get<JsonObject>(*it);
-		h_offset += 60 + MARGIN_Y;
-		int index = 0;
 		for (auto k = group.keys_begin(); k != group.keys_end(); ++k) {
-			const std::string& key = *k;
-			const std::string& val = group.get<std::string>(key);
-			int x = 0;
-			if (index % 2 == 0) {
-				x = window_state->screen_width / 2 - BUTTON_WIDTH - MARGIN_X;
-			} else {
-				x = window_state->screen_width / 2 + MARGIN_X + MARGIN_X / 2 + BUTTON_WIDTH;
+			if (lines.back().kind != Line::BINDINGS || lines.back().bindings == 2) {
+				lines.push_back({Line::BINDINGS, static_cast<int>(button_data.size()), 0});
 			}
-			buttons.emplace_back(x, h_offset, BUTTON_WIDTH, BUTTON_HEIGHT, val, 15);
-			button_data.emplace_back(*it, key);
-			text.emplace_back(x - BUTTON_WIDTH - MARGIN_X / 2, h_offset, BUTTON_WIDTH, BUTTON_HEIGHT, key + ":", 15);
-			if (index % 2 == 1) {
-				h_offset += BUTTON_HEIGHT + MARGIN_Y;
-			}
-			bool duplicate_binding = false;
-			for (int i = group_start; i < index + group_start; ++i) {
-				if (buttons[i].get_text() == buttons[index + group_start].get_text()) {
-					
-					duplicate_binding = true;
-					if (buttons[i].get_text_color().r != 0xFF) {
-						buttons[i].set_text_color(0xFF, 0x00, 0x00, 0xFF);
-					}
-				}
-			}
-			if (duplicate_binding) buttons[index + group_start].set_text_color(0xFF, 0x00, 0x00, 0xFF);
-			++index;
+			++lines.back().bindings;
+			button_data.emplace_back(*it, *k);
+			values.push_back(group.get<std::string>(*k));
 		}
-		if (index % 2 == 1) {
-			h_offset += BUTTON_HEIGHT + MARGIN_Y;
+	}
+	lines.push_back({Line::RESET, 0, 0});
+	update_conflicts();
+
+	Row prototype;
+	const int header_x = (window_state->screen_width - HEADER_WIDTH) / 2;
+	prototype.header = TextBox(header_x, MARGIN_Y, HEADER_WIDTH, HEADER_HEIGHT, "", 25);
+	for (int i = 0; i < 2; ++i) {
+		int x = 0;
+		if (i == 0) {
+			x = window_state->screen_width / 2 - BUTTON_WIDTH - MARGIN_X;
+		} else {
+			x = window_state->screen_width / 2 + MARGIN_X + MARGIN_X / 2 + BUTTON_WIDTH;
 		}
-		group_start += index;
+		prototype.buttons[i] = Button(x, MARGIN_Y, BUTTON_WIDTH, BUTTON_HEIGHT, "", 15);
+		prototype.labels[i] = TextBox(x - BUTTON_WIDTH - MARGIN_X / 2, MARGIN_Y, BUTTON_WIDTH, BUTTON_HEIGHT, "", 15);
 	}
-	
-	last_input_button = static_cast<int>(buttons.size()) - 1;
-	buttons.emplace_back((window_state->screen_width - 120) / 2, h_offset, 120, 60, "Reset", 25);
-	h_offset += 60 + MARGIN_Y;
-	
-	full_height = h_offset;
+	prototype.reset = Button(header_x, MARGIN_Y, HEADER_WIDTH, HEADER_HEIGHT, "Reset", 25);
+	list = VirtualList<Row>(
+		{0, 0, window_state->screen_width, window_state->screen_height}, ROW_HEIGHT, prototype,
+		[this](const int index, Row& row) { bind_row(index, row); }
+	);
+	list.set_count(static_cast<int>(lines.size()));
 	input_promt = TextBox(0, 0, window_state->screen_width, window_state->screen_height, "Press any button: ", 50);
 	waiting_for_input = false;
 }
 
-void OptionsMenu::handle_wheel(const SDL_MouseWheelEvent &e) {
-	camera_y -= 25 * e.y;
-	if (camera_y < 0 ) camera_y = 0;
-	if (camera_y > full_height - window_state->screen_height) {
-		camera_y = full_height - window_state->screen_height;
+void OptionsMenu::bind_row(const int index, Row& row) {
+	const Line& line = lines[index];
+	row.kind = line.kind;
+	row.first_binding = line.index;
+	row.bindings = line.bindings;
+	if (line.kind == Line::HEADER) {
+		row.header.set_text(groups[line.index]);
+	}
+	for (int i = 0; i < line.bindings; ++i) {
+		const int binding = line.index + i;
+		row.buttons[i].set_text(values[binding]);
+		row.labels[i].set_text(button_data[binding].second + ":");
+		if (conflicts[binding]) {
+			row.buttons[i].set_text_color(0xFF, 0x00, 0x00, 0xFF);
+		} else {
+			row.buttons[i].set_text_color(0x00, 0x00, 0x00, 0xFF);
+		}
+	}
+}
+
+void OptionsMenu::Row::render(const int x_offset, const int y_offset) {
+	switch (kind) {
+		case Line::HEADER:
+			header.render(x_offset, y_offset);
+			break;
+		case Line::BINDINGS:
+			for (int i = 0; i < bindings; ++i) {
+				buttons[i].render(x_offset, y_offset);
+				labels[i].render(x_offset, y_offset);
+			}
+			break;
+		case Line::RESET:
+			reset.render(x_offset, y_offset);
+			break;
+	}
+}
+
+int OptionsMenu::binding_at() {
+	int res = -1;
+	list.for_each_visible([this, &res](int, Row& row, const SDL_Point& origin) {
+		const int x = window_state->mouseX - origin.x, y = window_state->mouseY - origin.y;
+		if (row.kind == Line::RESET) {
+			if (row.reset.is_pressed(x, y)) res = static_cast<int>(button_data.size());
+			return;
+		}
+		for (int i = 0; i < row.bindings; ++i) {
+			if (row.buttons[i].is_pressed(x, y)) res = row.first_binding + i;
+		}
+	});
+	return res;
+}
+
+void OptionsMenu::update_conflicts() {
+	std::map<std::pair<std::string, std::string>, int> uses;
+	for (size_t i = 0; i < values.size(); ++i) {
+		++uses[{button_data[i].first, values[i]}];
+	}
+	conflicts.resize(values.size());
+	for (size_t i = 0; i < values.size(); ++i) {
+		conflicts[i] = uses[{button_data[i].first, values[i]}] > 1;
 	}
 }
 
+void OptionsMenu::handle_wheel(const SDL_MouseWheelEvent &e) {
+	list.scroll_by(-25 * e.y);
+}
+
 void OptionsMenu::handle_down(const SDL_Keycode key, const Uint8 mouse) {
 	if (!waiting_for_input) {
+		if (mouse == SDL_BUTTON_LEFT) {
+			targeted_binding = binding_at();
+		}
 		Menu::handle_down(key, mouse);
 	}
 }
@@ -122,61 +175,29 @@ void OptionsMenu::handle_up(const SDL_Keycode key,const Uint8 mouse) {
 	if (waiting_for_input) {
 		waiting_for_input = false;
 		
-		std::string old_input = buttons[btn].get_text();
-		std::string new_input = get_input_name(key, mouse);
+		values[btn] = get_input_name(key, mouse);
 		JsonObject& bindings = config::get_bindings(button_data[btn].first);
 
-		bindings.set<std::string>(button_data[btn].second, new_input);
-		buttons[btn].set_text(new_input);
-		color_matching(btn, new_input, old_input);
-	} else {
-		Menu::handle_up(key, mouse);
-	}
-}
-
-void OptionsMenu::color_matching(const int index, const std::string& cur, const std::string& old) {
-	bool taken_input = false;
-	bool single_old = false;
-	Button* old_match = nullptr;
-	for (int i = 0; i <= last_input_button; ++i) {
-		if (i == index || button_data[index].first != button_data[i].first) continue;
-		if (buttons[i].get_text() == old) {
-			if (old_match == nullptr) {
-				old_match = &buttons[i];
-				single_old = true;
-			} else {
-				single_old = false;
-			}
-		}
-		if (buttons[i].get_text() == cur) {
-			if (buttons[i].get_text_color().r == 0x00) {
-				buttons[i].set_text_color(0xFF, 0x00, 0x00, 0xFF);
-			}
-			taken_input = true;
+		bindings.set<std::string>(button_data[btn].second, values[btn]);
+		// Any binding of the group may have stopped or started conflicting.
+		update_conflicts();
+		list.invalidate();
+	} else if (mouse == SDL_BUTTON_LEFT) {
+		if (targeted_binding >= 0 && binding_at() == targeted_binding) {
+			button_press(targeted_binding);
 		}
 	}
-	if (single_old) {
-		old_match->set_text_color(0x00, 0x00, 0x00, 0xFF);
-	}
-	if (taken_input) {
-		if (buttons[index].get_text_color().r == 0x00) {
-			buttons[index].set_text_color(0xFF, 0x00, 0x00, 0xFF);
-		}
-	} else if (buttons[index].get_text_color().r == 0xFF) {
-		buttons[index].set_text_color(0x00, 0x00, 0x00, 0xFF);
-	}
 }
 
 void OptionsMenu::button_press(const int new_btn) {
-	if (new_btn > last_input_button) {
+	if (new_btn >= static_cast<int>(button_data.size())) {
 		config::reset_bindings();
 		const JsonObject& binds = config::get_bindings();
-		for (int i = 0; i < last_input_button; ++i) { 
-			buttons[i].set_text(binds.get<JsonObject>(button_data[i].first).get<std::string>(button_data[i].second));
-			if (buttons[i].get_text_color().r == 0xFF) {// Default bindings have no duplicates
-				buttons[i].set_text_color(0x00, 0x00, 0x00, 0xFF);
-			}
+		for (size_t i = 0; i < button_data.size(); ++i) {
+			values[i] = binds.get<JsonObject>(button_data[i].first).get<std::string>(button_data[i].second);
 		}
+		update_conflicts();
+		list.invalidate();
 	} else {
 		waiting_for_input = true;
 		btn = new_btn;
@@ -189,25 +210,26 @@ void OptionsMenu::menu_exit() {
 }
 
 void OptionsMenu::render() {
-	// A bit hacky... the game updates the mouse position after handling events, 
-	// 	so mouseY will still be offset when potential clicks get handled.
-	window_state->mouseY += camera_y; 
 	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 	SDL_RenderClear(gRenderer);
 
-	for (auto& b : buttons) {
-		b.set_hover(!waiting_for_input && b.is_pressed(window_state->mouseX, window_state->mouseY));
-		b.render(0, -camera_y);
-	}
-	for (auto& t : text) {
-		t.render(0, -camera_y);
-	}
+	list.for_each_visible([this](int, Row& row, const SDL_Point& origin) {
+		const int x = window_state->mouseX - origin.x, y = window_state->mouseY - origin.y;
+		for (int i = 0; i < row.bindings; ++i) {
+			row.buttons[i].set_hover(!waiting_for_input && row.buttons[i].is_pressed(x, y));
+		}
+		if (row.kind == Line::RESET) {
+			row.reset.set_hover(!waiting_for_input && row.reset.is_pressed(x, y));
+		}
+	});
+	list.render();
 	if (waiting_for_input) {
+		// The menu is drawn before the shade, and the prompt is queued after it.
+		gRenderQueue.flush();
 		SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0x50);
 		SDL_RenderFillRect(gRenderer, nullptr);
 		input_promt.render(0, 0);
 	}
-	SDL_RenderPresent(gRenderer);
 }
 
 void LevelMakerStartup::init(WindowState* ws) {
@@ -238,33 +260,55 @@ void LevelMakerStartup::init(WindowState* ws) {
 	
 	btn_texture = std::make_shared<Texture>();
 	btn_texture->load_from_file(config::get_asset_path("button.png"));
-	const JsonList& levels = config::get_levels();
-	levels_button_fits = (window_state->screen_width - 100) / 300;
-	if (levels_button_fits < levels.size()) {
-		buttons.emplace_back(50, 100, 25, 25, "<");
-		buttons.emplace_back(window_state->screen_width - 75, 100, 25, 25, ">");
-		levels_button_start = LEVELS_NEXT + 1;
-	} else {
-		levels_button_start = LEVELS_PREV;
+	// A column between the level settings and the start button.
+	levels = VirtualList<Button>(
+		{(window_state->screen_width - LEVEL_WIDTH) / 2, 50, LEVEL_WIDTH, window_state->screen_height - 100},
+		LEVEL_HEIGHT + LEVEL_MARGIN, Button(0, 0, LEVEL_WIDTH, LEVEL_HEIGHT, "", btn_texture),
+		[](const int index, Button& row) {
+			row.set_text(config::get_level(index).get<std::string>("name"));
+		}
+	);
+	levels.set_count(static_cast<int>(config::get_levels().size()));
+}
+
+void LevelMakerStartup::invalidate(const std::vector<std::string>& keys) {
+	const bool levels_changed = std::any_of(keys.begin(), keys.end(), config::is_level_key);
+	if (!levels_changed) return;
+	const int count = static_cast<int>(config::get_levels().size());
+	levels.set_count(count);
+	targeted_level = -1;
+	if (loaded >= count) {
+		button_press(NEW_LEVEL);
+	} else if (loaded >= 0 && std::find(keys.begin(), keys.end(), config::level_key(loaded)) != keys.end()) {
+		select_level(loaded);
 	}
-	levels_button_page = 0;
-	create_levels_buttons(levels);
 }
 
-void LevelMakerStartup::create_levels_buttons(const JsonList& levels) {
-	const int start_x = window_state->screen_width / 2 - (300 * levels_button_fits) / 2 + 25;
-	for (int i = 0; i < levels_button_fits; ++i) {
-		if (i + levels_button_fits * levels_button_page >= levels.size()) break;
-		const std::string& text = levels.get<JsonObject>(i + levels_button_fits * levels_button_page).get<std::string>("name");
-		if (buttons.size() > i + levels_button_start) {
-			buttons[i + levels_button_start].set_text(text);
-		} else {
-			buttons.emplace_back(start_x + i * 300, 50, 250, 100, text, btn_texture);
-		}
+void LevelMakerStartup::handle_wheel(const SDL_MouseWheelEvent &e) {
+	levels.scroll_by(-25 * e.y);
+}
+
+void LevelMakerStartup::handle_down(const SDL_Keycode key, const Uint8 mouse) {
+	if (mouse == SDL_BUTTON_LEFT) {
+		targeted_level = levels.index_at(window_state->mouseX, window_state->mouseY);
 	}
-	while (buttons.size() - levels_button_start > levels.size() - levels_button_page * levels_button_fits) {
-		buttons.pop_back();
+	Menu::handle_down(key, mouse);
+}
+
+void LevelMakerStartup::handle_up(const SDL_Keycode key, const Uint8 mouse) {
+	if (mouse == SDL_BUTTON_LEFT && targeted_level >= 0 &&
+		levels.index_at(window_state->mouseX, window_state->mouseY) == targeted_level) {
+		select_level(targeted_level);
 	}
+	Menu::handle_up(key, mouse);
+}
+
+void LevelMakerStartup::render() {
+	Menu::render();
+	levels.for_each_visible([this](int, Button& row, const SDL_Point& origin) {
+		row.set_hover(row.is_pressed(window_state->mouseX - origin.x, window_state->mouseY - origin.y));
+	});
+	levels.render();
 }
 
 void LevelMakerStartup::create_default_level() {
@@ -311,35 +355,25 @@ void LevelMakerStartup::button_press(const int btn) {
 			}
 			break;
 		default:
-			if (btn >= levels_button_start) {
-				loaded = btn + levels_button_page * levels_button_fits - levels_button_start;
-				const JsonObject& lvl = config::get_level(loaded);
-				const JsonObject& conf = config::get_level_config(lvl.get<std::string>("config"));
-				try {
-					LevelData temp;
-					temp.load_from_file(
-						config::get_level_path(lvl.get<std::string>("file")), 
-						conf.get<int>("tile_count")
-					);
-					data = std::move(temp);
-				} catch (const base_exception& e) {
-					std::cout << e.msg << std::endl;
-					loaded = -1;
-				}
-				text[1].set_text("Height: " + std::to_string(data.height));
-				text[2].set_text(loaded == -1 ? "Data: clear" : "Data: " + lvl.get<std::string>("name"));
-			} else if (btn == LEVELS_PREV) {
-				if (levels_button_page > 0) { 
-					--levels_button_page;
-					const JsonList& lvls = config::get_levels();
-					create_levels_buttons(lvls);
-				}
-			} else if (btn == LEVELS_NEXT) {
-				const JsonList& lvls = config::get_levels();
-				if ((levels_button_page + 1) * levels_button_fits < lvls.size()) {
-					++levels_button_page;
-					create_levels_buttons(lvls);
-				}
-			}
+			break;
+	}
+}
+
+void LevelMakerStartup::select_level(const int level) {
+	loaded = level;
+	const JsonObject& lvl = config::get_level(loaded);
+	const JsonObject& conf = config::get_level_config(lvl.get<std::string>("config"));
+	try {
+		LevelData temp;
+		temp.load_from_file(
+			config::get_level_path(lvl.get<std::string>("file")), 
+			conf.get<int>("tile_count")
+		);
+		data = std::move(temp);
+	} catch (const base_exception& e) {
+		std::cout << e.msg << std::endl;
+		loaded = -1;
 	}
-}
\ No newline at end of file
+	text[1].set_text("Height: " + std::to_string(data.height));
+	text[2].set_text(loaded == -1 ? "Data: clear" : "Data: " + lvl.get<std::string>("name"));
+}
@@ -47,6 +47,8 @@ class OptionsMenu : public Menu {
 
 		static const int MARGIN_X = 40, MARGIN_Y = 30;
 		static const int BUTTON_WIDTH = 100, BUTTON_HEIGHT = 50;
+		static const int HEADER_WIDTH = 120, HEADER_HEIGHT = 60;
+		static const int ROW_HEIGHT = HEADER_HEIGHT + MARGIN_Y;
 
 		void handle_down(SDL_Keycode key, Uint8 mouse) override;
 
@@ -61,20 +63,63 @@ class OptionsMenu : public Menu {
         void menu_exit() override;
 
 	private:
+		/**
+		 * A line of the list: the name of a group, up to two bindings of a group or the reset button.
+		 */
+		struct Line {
+			enum Kind {
+				HEADER, BINDINGS, RESET
+			} kind;
+			// Index into groups for headers, of the first binding for bindings.
+			int index;
+			int bindings;
+		};
+
+		/**
+		 * Widgets showing a line, positioned relative to the top of the line.
+		 * Laid out once by init, binding only changes their text and colour.
+		 */
+		struct Row {
+			Line::Kind kind = Line::HEADER;
+			int first_binding = 0;
+			int bindings = 0;
+			TextBox header;
+			TextBox labels[2];
+			Button buttons[2];
+			Button reset;
+
+			void render(int x_offset, int y_offset);
+		};
+
 		bool waiting_for_input = false;
 
 		TextBox input_promt;
 
+		std::vector<std::string> groups;
+
 		//(Key to grouping, key to binding)
 		std::vector<std::pair<const std::string, std::string>> button_data;
 
-		int last_input_button = 0;
+		// Current input of every binding, and if another binding of its group has the same input.
+		std::vector<std::string> values;
+		std::vector<bool> conflicts;
+
+		std::vector<Line> lines;
+
+		VirtualList<Row> list;
 
 		int btn = -1;
 
-		int full_height = 0, camera_y = 0;
+		int targeted_binding = -1;
+
+		void bind_row(int index, Row& row);
+
+		/**
+		 * Returns the binding of the button at the mouse, the number of bindings for the reset button or -1 if there is none.
+		 */
+		int binding_at();
 
-		void color_matching(int index, const std::string& cur, const std::string& old);
+		void update_conflicts();
 
 };
 
@@ -84,24 +129,39 @@ class LevelMakerStartup : public Menu {
 
         void init(WindowState* window_state) override;
 
+		void handle_down(SDL_Keycode key, Uint8 mouse) override;
+
+		void handle_up(SDL_Keycode key, Uint8 mouse) override;
+
+		void render() override;
+
+		/**
+		 * Refreshes the level list after levels.json was reloaded, dropping the loaded level if it is gone.
+		 */
+		void invalidate(const std::vector<std::string>& keys) override;
+
 	protected:
 
         void button_press(int btn) override;
 
+        void handle_wheel(const SDL_MouseWheelEvent &e) override;
+
 	private:
+		static const int LEVEL_WIDTH = 250, LEVEL_HEIGHT = 100, LEVEL_MARGIN = 10;
+
 		enum ButtonId {
-			START_LEVEL_MAKER, NEW_LEVEL, ADD_HEIGHT, SUB_HEIGHT, LEVELS_PREV, LEVELS_NEXT
+			START_LEVEL_MAKER, NEW_LEVEL, ADD_HEIGHT, SUB_HEIGHT
 		};
 
 		void create_default_level();
-		
-		void create_levels_buttons(const JsonList& levels);
+
+		void select_level(int level);
 
 		int loaded = -1;
-		
-		int levels_button_start = 0;
-		int levels_button_fits = 0;
-		int levels_button_page = 0;
+
+		// Levels of the config, with the level under the mouse at the last left click.
+		VirtualList<Button> levels;
+		int targeted_level = -1;
 		
 		std::shared_ptr<Texture> btn_texture;
 
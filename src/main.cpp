@@ -1,10 +1,19 @@
 #include <vector>
 #include <iostream>
+#include <cstdio>
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_ttf.h>
 #include "util/exceptions.h"
 #include "engine/game.h"
+#include "engine/glyphAtlas.h"
+#include "engine/jobs.h"
+#include "engine/profiler.h"
+#include "engine/renderBench.h"
+#include "engine/replay.h"
+#include "file/jsonBench.h"
+#include "game/climbGame.h"
+#include "game/levelMaker.h"
 #include "game/menu.h"
 #include "game/config.h"
 
@@ -14,6 +23,7 @@
  **/
 void cleanup()
 {
+	engine::stop_jobs();
 	if (gRenderer != nullptr)
 	{
 		std::cout << "Destroying renderer" << std::endl;
@@ -70,22 +80,209 @@ void init() {
 	}
 }
 
+/**
+ * Replays the recording at path into a ClimbGame without a window, and prints the timing and final state.
+ * If hash_file is not empty, the state hash after every tick is written to it.
+ */
+int run_replay(const std::string& path, const std::string& hash_file) {
+	try {
+		Replay replay(path);
+		std::unique_ptr<FileWriter> hashes;
+		if (!hash_file.empty()) {
+			hashes = std::make_unique<FileWriter>(hash_file, false);
+		}
+		// The renderer has to outlive the game, which owns textures created with it.
+		HeadlessRenderer renderer(replay.get_screen_width(), replay.get_screen_height());
+		ClimbGame game;
+		const ReplayResult result = replay.run(game, hashes.get());
+		if (hashes != nullptr && !hashes->flush()) {
+			std::cout << "Could not write state hashes to " << hash_file << std::endl;
+		}
+		std::cout << "Replayed " << result.ticks << " ticks, " << result.simulated_time << " s of play in "
+			<< result.elapsed_time * 1000.0 << " ms";
+		if (result.ticks > 0) {
+			std::cout << " (" << result.elapsed_time * 1e6 / result.ticks << " us per tick)";
+		}
+		std::cout << std::endl;
+		if (!result.completed) {
+			std::cout << "The game ended before the recording did" << std::endl;
+		}
+		if (result.first_divergent_tick != 0) {
+			std::cout << "State diverged from the recording after tick " << result.first_divergent_tick << std::endl;
+		}
+		game.report(std::cout);
+		std::cout << "Final state hash " << std::hex << result.final_hash << std::dec << std::endl;
+		return result.completed && result.first_divergent_tick == 0 ? 0 : -5;
+	} catch (const base_exception &e) {
+		std::cout << e.msg << std::endl;
+		return -1;
+	}
+}
+
+/**
+ * Renders the state named state_name ("menu", "game" or "level_maker") for frames frames into an offscreen surface,
+ * and prints the frame times and framebuffer checksum. Returns nonzero if expected is not empty and the checksum differs.
+ * If frame_stats_file is not empty, the frame times are written to it.
+ */
+int run_render_bench(
+	const std::string& state_name, const int frames, const std::string& expected, const std::string& frame_stats_file
+) {
+	constexpr int BENCH_WIDTH = 1280;
+	constexpr int BENCH_HEIGHT = 720;
+	try {
+		// Some states need a window, even though the dummy driver never shows it.
+		gWindow = SDL_CreateWindow("Render bench", 0, 0, BENCH_WIDTH, BENCH_HEIGHT, SDL_WINDOW_HIDDEN);
+		if (gWindow == nullptr) {
+			throw SDL_exception("Could not create window, " + std::string(SDL_GetError()));
+		}
+		HeadlessRenderer renderer(BENCH_WIDTH, BENCH_HEIGHT);
+		RenderBench bench(BENCH_WIDTH, BENCH_HEIGHT);
+		std::unique_ptr<State> state;
+		SDL_Surface* framebuffer = renderer.get_surface();
+		if (state_name == "menu") {
+			state = std::make_unique<MainMenu>();
+		} else if (state_name == "game") {
+			state = std::make_unique<ClimbGame>();
+		} else if (state_name == "level_maker") {
+			const JsonObject& lvl = config::get_level(0);
+			LevelData data;
+			data.load_from_file(
+				config::get_level_path(lvl.get<std::string>("file")),
+				config::get_level_config(lvl.get<std::string>("config")).get<int>("tile_count")
+			);
+			state = std::make_unique<LevelMaker>(
+				std::move(data), LevelConfig::load_from_json(config::get_level_config(lvl.get<std::string>("config")))
+			);
+			// The level maker draws to the window surface instead of using the renderer.
+			framebuffer = SDL_GetWindowSurface(gWindow);
+			if (framebuffer == nullptr) {
+				throw SDL_exception("Could not get window surface, " + std::string(SDL_GetError()));
+			}
+		} else {
+			std::cout << "Unknown state \"" << state_name << "\", expected menu, game or level_maker" << std::endl;
+			return -1;
+		}
+		const RenderBenchResult result = bench.run(*state, frames, framebuffer);
+		// Textures have to be freed before the renderer is destroyed.
+		state.reset();
+		free_glyph_atlases();
+
+		std::cout << "Rendered " << result.frames << " frames of " << state_name << std::endl;
+		const std::pair<FramePhase, const char*> phases[] = {
+			{FramePhase::TICK, "Tick"}, {FramePhase::RENDER, "Render"}, {FramePhase::PRESENT, "Present"}, {FramePhase::FRAME, "Frame"}
+		};
+		for (const auto& [phase, name] : phases) {
+			const FrameTimeSummary summary = result.stats.summary(phase);
+			std::cout << name << ": p50 " << summary.p50 << " ms, p95 " << summary.p95
+				<< " ms, p99 " << summary.p99 << " ms, max " << summary.max << " ms" << std::endl;
+		}
+		if (result.frames > 0) {
+			std::cout << "Queued commands per frame " << static_cast<double>(result.commands) / result.frames
+				<< ", draw calls per frame " << static_cast<double>(result.draw_calls) / result.frames << std::endl;
+		}
+		char checksum[17];
+		std::snprintf(checksum, sizeof(checksum), "%016llx", static_cast<unsigned long long>(result.checksum));
+		std::cout << "Framebuffer checksum " << checksum << std::endl;
+		if (!frame_stats_file.empty() && !result.stats.write_csv(frame_stats_file)) {
+			std::cout << "Could not write frame stats to " << frame_stats_file << std::endl;
+		}
+		if (!expected.empty() && expected != checksum) {
+			std::cout << "Expected checksum " << expected << std::endl;
+			return -5;
+		}
+		return 0;
+	} catch (const base_exception &e) {
+		std::cout << e.msg << std::endl;
+		return -1;
+	}
+}
+
+/**
+ * Times parsing of every config file scaled up to copies copies and lookups of object keys, and prints the results.
+ */
+int run_json_bench(const int copies) {
+	constexpr int ITERATIONS = 20;
+	constexpr int LOOKUPS = 10000000;
+	try {
+		json::bench_parse(config::get_json_files(), copies, ITERATIONS, std::cout);
+		json::bench_keys(LOOKUPS, std::cout);
+		return 0;
+	} catch (const base_exception &e) {
+		std::cout << e.msg << std::endl;
+		return -1;
+	}
+}
+
+/**
+ * Round-trips count random ints and doubles through the json writer and reader, and prints the results.
+ * Returns nonzero if any number changed.
+ */
+int run_json_roundtrip(const int count) {
+	constexpr uint64_t SEED = 0x5EED;
+	try {
+		return json::check_number_roundtrip(count, SEED, std::cout) ? 0 : -5;
+	} catch (const base_exception &e) {
+		std::cout << e.msg << std::endl;
+		return -1;
+	}
+}
+
 int main(int argc, char* args[])
 {
 	atexit(cleanup);
 	at_quick_exit(cleanup);
 
 	bool level_maker = false;
+	bool threaded = false;
+	std::string frame_stats_file;
+	std::string profile_file;
+	std::string record_file;
+	std::string replay_file;
+	std::string hash_file;
+	std::string bench_state;
+	std::string expected_checksum;
+	int bench_frames = 600;
+	bool json_bench = false;
+	int json_copies = 1000;
+	int json_roundtrip_count = 0;
 
 	if (argc > 1) {
 		for (int i = 1; i < argc; ++i) {
 			if (strcmp(args[i], "level_maker") == 0 || strcmp(args[i], "--level_maker") == 0 ) {
 				level_maker = true;
-				break;
-			} 
+			} else if (strcmp(args[i], "threaded") == 0 || strcmp(args[i], "--threaded") == 0) {
+				threaded = true;
+			} else if ((strcmp(args[i], "frame_stats") == 0 || strcmp(args[i], "--frame_stats") == 0) && i + 1 < argc) {
+				frame_stats_file = args[++i];
+			} else if ((strcmp(args[i], "profile") == 0 || strcmp(args[i], "--profile") == 0) && i + 1 < argc) {
+				profile_file = args[++i];
+			} else if ((strcmp(args[i], "record") == 0 || strcmp(args[i], "--record") == 0) && i + 1 < argc) {
+				record_file = args[++i];
+			} else if ((strcmp(args[i], "replay") == 0 || strcmp(args[i], "--replay") == 0) && i + 1 < argc) {
+				replay_file = args[++i];
+			} else if ((strcmp(args[i], "hashes") == 0 || strcmp(args[i], "--hashes") == 0) && i + 1 < argc) {
+				hash_file = args[++i];
+			} else if ((strcmp(args[i], "render_bench") == 0 || strcmp(args[i], "--render_bench") == 0) && i + 1 < argc) {
+				bench_state = args[++i];
+			} else if ((strcmp(args[i], "frames") == 0 || strcmp(args[i], "--frames") == 0) && i + 1 < argc) {
+				bench_frames = atoi(args[++i]);
+			} else if ((strcmp(args[i], "expect") == 0 || strcmp(args[i], "--expect") == 0) && i + 1 < argc) {
+				expected_checksum = args[++i];
+			} else if (strcmp(args[i], "json_bench") == 0 || strcmp(args[i], "--json_bench") == 0) {
+				json_bench = true;
+			} else if ((strcmp(args[i], "json_roundtrip") == 0 || strcmp(args[i], "--json_roundtrip") == 0) && i + 1 < argc) {
+				json_roundtrip_count = atoi(args[++i]);
+			} else if ((strcmp(args[i], "copies") == 0 || strcmp(args[i], "--copies") == 0) && i + 1 < argc) {
+				json_copies = atoi(args[++i]);
+			}
 		}
 	}
 	
+	if (!replay_file.empty() || !bench_state.empty() || json_bench || json_roundtrip_count > 0) {
+		// Replays and benches never show a window.
+		SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+	}
+	
 	init();
 
 	int exit_status = 0;
@@ -93,8 +290,36 @@ int main(int argc, char* args[])
 		return -4;
 	}
 
-	StateGame game(new MainMenu(), 100, 100, "Grapple Game");
-	run_game(game, exit_status);
+	if (!profile_file.empty()) {
+		profiler::set_thread_name("main");
+		profiler::set_enabled(true);
+	}
+
+	if (!replay_file.empty()) {
+		exit_status = run_replay(replay_file, hash_file);
+	} else if (!bench_state.empty()) {
+		exit_status = run_render_bench(bench_state, bench_frames, expected_checksum, frame_stats_file);
+	} else if (json_bench) {
+		exit_status = run_json_bench(json_copies);
+	} else if (json_roundtrip_count > 0) {
+		exit_status = run_json_roundtrip(json_roundtrip_count);
+	} else {
+		StateGame game(new MainMenu(), 100, 100, "Grapple Game");
+		game.set_invalidation_source(config::poll_changes);
+		game.set_threaded(threaded);
+		game.set_frame_stats_file(frame_stats_file);
+		game.set_recording_file(record_file);
+		run_game(game, exit_status);
+	}
+
+	// The game is destroyed first, so that the simulation thread has stopped recording zones.
+	if (!profile_file.empty()) {
+		try {
+			profiler::write_trace(profile_file);
+		} catch (const base_exception &e) {
+			std::cout << e.msg << std::endl;
+		}
+	}
 
 	return exit_status;
 }
\ No newline at end of file
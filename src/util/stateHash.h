@@ -0,0 +1,48 @@
+#ifndef STATE_HASH_00_H
+#define STATE_HASH_00_H
+#include <cstdint>
+#include <cstring>
+#include "utilities.h"
+
+/**
+ * Hashes simulation state value by value, to find the first tick where two runs diverge. Not cryptographic.
+ * Doubles are hashed by their bits, so every change is noticed except the sign of a zero.
+ */
+class StateHasher {
+	public:
+		void add(const uint64_t v) {
+			h = (h ^ v) * PRIME;
+			h ^= h >> 29;
+		}
+
+		void add(const int v) {
+			add(static_cast<uint64_t>(static_cast<int64_t>(v)));
+		}
+
+		void add(const bool b) {
+			add(static_cast<uint64_t>(b));
+		}
+
+		void add(double d) {
+			if (d == 0.0) d = 0.0;
+			uint64_t bits;
+			memcpy(&bits, &d, sizeof(bits));
+			add(bits);
+		}
+
+		void add(const Vector2D& v) {
+			add(v.x);
+			add(v.y);
+		}
+
+		[[nodiscard]] uint64_t get() const {
+			return h ^ (h >> 32);
+		}
+
+	private:
+		static constexpr uint64_t PRIME = 0x9E3779B97F4A7C15ull;
+
+		uint64_t h = PRIME;
+};
+
+#endif